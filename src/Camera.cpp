@@ -3,8 +3,6 @@
 #include <Eigen/Geometry>
 #include <numbers>
 
-#include "util/random.h"
-
 Camera::Camera(Eigen::Vector3f position, const Eigen::Vector3f& rotation,
                const float focal_length, const float width, const float height,
                const unsigned int resolution_x, const unsigned int resolution_y,
@@ -30,13 +28,13 @@ Camera::Camera(Eigen::Vector3f position, const Eigen::Vector3f& rotation,
     u = v.cross(w);                             // right
 }
 
-Ray Camera::viewing_ray(const unsigned int i, const unsigned int j) const {
+Ray Camera::viewing_ray(const unsigned int i, const unsigned int j,
+                        Random& rng) const {
     const auto res_w = static_cast<float>(resolution_x);
     const auto res_h = static_cast<float>(resolution_y);
 
-    std::uniform_real_distribution<float> dist(0.F, 1.F);
-    const float pixel_x = static_cast<float>(j) + dist(rng);
-    const float pixel_y = static_cast<float>(i) + dist(rng);
+    const float pixel_x = static_cast<float>(j) + rng.uniform();
+    const float pixel_y = static_cast<float>(i) + rng.uniform();
 
     const float pixel_u = (pixel_x / res_w - 0.5F) * width;
     const float pixel_v = -(pixel_y / res_h - 0.5F) * height;
@@ -4,6 +4,7 @@
 #include <Eigen/Core>
 
 #include "Ray.h"
+#include "util/random.h"
 
 class Camera {
    public:
@@ -12,7 +13,16 @@ class Camera {
            unsigned int resolution_x, unsigned int resolution_y,
            float exposure);
 
-    [[nodiscard]] Ray viewing_ray(unsigned int i, unsigned int j) const;
+    /**
+     * Generate a ray through a random point of a pixel.
+     *
+     * @param i Row of the pixel.
+     * @param j Column of the pixel.
+     * @param rng Random number generator.
+     * @return Viewing ray from the camera position.
+     */
+    [[nodiscard]] Ray viewing_ray(unsigned int i, unsigned int j,
+                                  Random& rng) const;
 
     Eigen::Vector3f position;   // Camera position.
     Eigen::Vector3f u;          // The up vector.
@@ -2,6 +2,7 @@
 #define INTERSECION_H
 
 #include <Eigen/Core>
+#include <cstdint>
 #include <limits>
 
 class Geometry;
@@ -11,8 +12,10 @@ class Intersection {
     constexpr Intersection()
         : object(nullptr), t(std::numeric_limits<float>::infinity()) {}
 
-    Intersection(const Geometry* const object, const float t)
-        : object(object), t(t) {}
+    Intersection(const Geometry* const object, const float t,
+                 const uint32_t primitive = 0, const float u = 0.F,
+                 const float v = 0.F)
+        : object(object), t(t), primitive(primitive), u(u), v(v) {}
 
     [[nodiscard]] const Intersection& earlier(const Intersection& other) const {
         return (t < other.t) ? *this : other;
@@ -26,6 +29,16 @@ class Intersection {
     const Geometry* object;
     // Distance along the ray to the intersection point.
     float t;
+    // Index of the intersected primitive within the object.
+    uint32_t primitive = 0;
+    // Surface parameters of the hit. For a triangle, the barycentric weights
+    // of its second and third vertices.
+    float u = 0.F;
+    float v = 0.F;
+    // Instance placing the intersected object in the scene, or nullptr if the
+    // object is not instanced. The other members are then in the space of
+    // the object, except `t` which is the same in both spaces.
+    const Geometry* instance = nullptr;
 };
 
 #endif
@@ -2,8 +2,11 @@
 #define OBJECT_H
 
 #include <Eigen/Core>
+#include <optional>
 
 #include "Ray.h"
+#include "light/LightBounds.h"
+#include "util/random.h"
 
 class Object {
    public:
@@ -19,10 +22,12 @@ class Object {
      * Generate a ray from a given point toward the Light object.
      *
      * @param [in] point Point from which the ray is generated.
+     * @param [in,out] rng Random number generator.
      * @return Ray from `point` toward the Light.
      */
     [[nodiscard]] virtual Ray ray_from(
-        [[maybe_unused]] const Eigen::Vector3f point) const {
+        [[maybe_unused]] const Eigen::Vector3f point,
+        [[maybe_unused]] Random& rng) const {
         throw std::logic_error("ray_from() not implemented for this object.");
     }
 
@@ -41,6 +46,14 @@ class Object {
         throw std::logic_error("inv_pdf() not implemented for this object.");
     }
 
+    /**
+     * Check whether rays can hit the object, so that its emission is also
+     * found by paths that sample the BRDF.
+     *
+     * @return Whether the object is part of the scene geometry.
+     */
+    [[nodiscard]] virtual bool is_hittable() const { return true; }
+
     /**
      * Get the emission of the object.
      *
@@ -52,6 +65,31 @@ class Object {
         throw std::logic_error(
             "emission_at() not implemented for this object.");
     }
+
+    /**
+     * Estimate the total power emitted by the object, used to choose light
+     * sources in proportion to their contribution.
+     *
+     * @param [in] scene_radius Radius of a sphere bounding the scene, for light
+     * sources at infinity.
+     * @return Luminance of the emitted power.
+     */
+    [[nodiscard]] virtual float power(
+        [[maybe_unused]] const float scene_radius) const {
+        throw std::logic_error("power() not implemented for this object.");
+    }
+
+    /**
+     * Bound the emission of the object, to choose light sources by their
+     * contribution to a shading point.
+     *
+     * @return Bounds of the emission, or nullopt for light sources at
+     * infinity.
+     */
+    [[nodiscard]] virtual std::optional<LightBounds> light_bounds() const {
+        throw std::logic_error(
+            "light_bounds() not implemented for this object.");
+    }
 };
 
 #endif
@@ -1,11 +1,72 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
 
+#include <cstdint>
+
+#include "bvh/BVHOptions.h"
+#include "util/TileScheduler.h"
+
+enum class LightSampler : uint8_t {
+    // Proportionally to the power of the lights, regardless of the shading
+    // point.
+    Power,
+    // By the estimated contribution to the shading point, through a light
+    // BVH. Best for scenes with many lights.
+    BVH,
+};
+
+struct AdaptiveSamplingOptions {
+    // Whether the number of samples adapts to the noise of each pixel. The
+    // samples left by the pixels that stop early are spent on the others, so
+    // that `samples` becomes the average number of samples per pixel.
+    bool enabled = false;
+    // Number of samples per pixel before a pixel may stop.
+    unsigned int min_samples = 16;
+    // Maximum number of samples per pixel (0 for 4 times `samples`).
+    unsigned int max_samples = 0;
+    // Relative standard error of the pixel luminance at which a pixel stops.
+    float threshold = 0.01F;
+};
+
+struct ProgressiveOptions {
+    // Whether the image is rendered in full-frame passes of increasing number
+    // of samples, until the time budget or the target number of samples is
+    // reached.
+    bool enabled = false;
+    // Wall-clock budget of the rendering in seconds (0 for unlimited).
+    float time_budget = 0.F;
+    // Interval in seconds between the intermediate images (0 to disable).
+    float preview_interval = 0.F;
+};
+
 struct Options {
-    // Number of samples per pixel.
+    // Number of samples per pixel, on average with adaptive sampling.
     unsigned int samples;
+    // Options for adaptive sampling.
+    AdaptiveSamplingOptions adaptive;
+    // Options for progressive rendering, which stops when the samples are
+    // spent or the time budget is reached.
+    ProgressiveOptions progressive;
     // Clamping value for each ray.
     float ray_clamp;
+    // Maximum number of indirect bounces of a path.
+    unsigned int max_bounces;
+    // Number of bounces before Russian roulette starts terminating paths.
+    unsigned int russian_roulette_depth;
+    // Width and height of the tiles distributed to the threads, in pixels.
+    unsigned int tile_size;
+    // Order in which the tiles are rendered.
+    TileOrder tile_order;
+    // How the light sampled for direct lighting is chosen.
+    LightSampler light_sampler;
+    // Seed of the random number generators.
+    uint64_t seed;
+    // Whether the meshes read from files and the BVH are cached in files next
+    // to the mesh files and the scene file, to be loaded faster next time.
+    // Off by default, as the directories may be read-only or shared.
+    bool cache;
+    // Options for building the BVH.
+    BVHOptions bvh;
 };
 
 #endif
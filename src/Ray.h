@@ -16,7 +16,9 @@ class Ray {
 
     // Origin point of the ray.
     Eigen::Vector3f origin;
-    // Unit direction vector.
+    // Direction vector. It is a unit vector in world space, but is scaled
+    // by the transform of an instance in the space of its object, so that `t`
+    // is the same distance along the ray in both spaces.
     Eigen::Vector3f direction;
     float min_t;
     float max_t;
@@ -1,14 +1,22 @@
 #include "Scene.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 
 #include "bvh/build_bvh.h"
+#include "util/Timer.h"
 
 Scene::Scene(Options options, Camera camera,
              std::vector<std::unique_ptr<Geometry>> geometries,
              std::vector<std::unique_ptr<Light>> lights)
     : options(options), camera(std::move(camera)), lights(std::move(lights)) {
+    size_t num_primitives = 0;
+    for (const auto& geometry : geometries) {
+        num_primitives += geometry->num_primitives();
+    }
     std::cout << "Geometries: " << geometries.size() << "\n";
+    std::cout << "Primitives: " << num_primitives << "\n";
     std::cout << "Lights: " << this->lights.size() << "\n";
 
     // Collect emissive objects
@@ -17,13 +25,40 @@ Scene::Scene(Options options, Camera camera,
         emissive_objects.emplace_back(light.get());
     }
     for (const auto& geometry : geometries) {
-        if (geometry->material->emissive) {
-            emissive_objects.emplace_back(geometry.get());
-        }
+        std::ranges::copy(geometry->emitters(),
+                          std::back_inserter(emissive_objects));
     }
     emissive_objects.shrink_to_fit();
 
     std::cout << "Emissive objects: " << emissive_objects.size() << "\n";
 
-    this->geometries = build_bvh(std::move(geometries));
+    if (this->options.light_sampler == LightSampler::BVH) {
+        Timer timer("Build light BVH");
+        light_bvh = LightBVH(emissive_objects);
+    } else {
+        // Weight the emissive objects by their power, so that bright and
+        // large light sources receive more shadow rays.
+        AABB scene_bounds;
+        for (const auto& geometry : geometries) {
+            scene_bounds.merge(geometry->bounding_box);
+        }
+        const float scene_radius =
+            geometries.empty() ? 0.F : scene_bounds.dimensions().norm() / 2;
+
+        std::vector<float> powers;
+        powers.reserve(emissive_objects.size());
+        for (const Object* const object : emissive_objects) {
+            powers.emplace_back(std::max(object->power(scene_radius), 0.F));
+        }
+        light_distribution = AliasTable(powers);
+
+        emissive_indices.reserve(emissive_objects.size());
+        for (uint32_t i = 0; i < emissive_objects.size(); i++) {
+            emissive_indices[emissive_objects[i]] = i;
+        }
+    }
+
+    Timer timer("Build BVH");
+    this->geometries = build_bvh(std::move(geometries), this->options.bvh);
+    bvh_build_time = timer.elapsed();
 }
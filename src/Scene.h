@@ -1,10 +1,14 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <unordered_map>
+
 #include "Camera.h"
 #include "Options.h"
 #include "geometry/Geometry.h"
 #include "light/Light.h"
+#include "light/LightBVH.h"
+#include "util/AliasTable.h"
 
 class Scene {
    public:
@@ -16,10 +20,19 @@ class Scene {
     Camera camera;
     // The BVH for all geometries
     std::unique_ptr<Geometry> geometries;
+    // Time taken to build (or read) the BVH, in milliseconds.
+    float bvh_build_time = 0.F;
     // Lights
     std::vector<std::unique_ptr<Light>> lights;
     // List of emissive objects for random access
-    std::vector<Object*> emissive_objects;
+    std::vector<const Object*> emissive_objects;
+    // Distribution of `emissive_objects` weighted by their emitted power,
+    // with `LightSampler::Power`
+    AliasTable light_distribution;
+    // Index of each object in `emissive_objects`, with `LightSampler::Power`
+    std::unordered_map<const Object*, uint32_t> emissive_indices;
+    // Hierarchy over `emissive_objects`, with `LightSampler::BVH`
+    LightBVH light_bvh;
 };
 
 #endif
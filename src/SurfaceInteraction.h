@@ -0,0 +1,67 @@
+#ifndef SURFACE_INTERACTION_H
+#define SURFACE_INTERACTION_H
+
+#include <Eigen/Dense>
+#include <cmath>
+
+#include "material/Material.h"
+
+/**
+ * Shading information at a surface hit, computed once per hit.
+ */
+struct SurfaceInteraction {
+    // Position of the hit.
+    Eigen::Vector3f point;
+    // Unit shading normal, facing the incoming ray.
+    Eigen::Vector3f normal;
+    // Texture coordinates.
+    Eigen::Vector2f texcoords;
+    // Orthonormal tangent space where columns are tangent, bitangent, and
+    // normal vectors.
+    Eigen::Matrix3f tangent_space;
+    // Material of the surface.
+    const Material* material;
+
+    /**
+     * Replace the shading normal, and re-orthogonalize the tangent space
+     * around it.
+     *
+     * @param new_normal Unit shading normal.
+     */
+    void set_normal(const Eigen::Vector3f& new_normal) {
+        normal = new_normal;
+        tangent_space = make_tangent_space(normal, tangent_space.col(0));
+    }
+
+    /**
+     * Build an orthonormal tangent space around a normal. The tangent is
+     * projected onto the plane of the normal, or replaced by an arbitrary
+     * perpendicular vector if it is zero or (nearly) parallel to the normal.
+     *
+     * @param normal Unit normal vector.
+     * @param tangent Approximate tangent vector, or zero if unknown.
+     * @return Tangent space matrix where columns are tangent, bitangent, and
+     *         normal vectors.
+     */
+    static Eigen::Matrix3f make_tangent_space(const Eigen::Vector3f& normal,
+                                              const Eigen::Vector3f& tangent) {
+        Eigen::Vector3f t = tangent - normal * normal.dot(tangent);
+        const float length = t.norm();
+        if (length > 1e-6F) {
+            t /= length;
+        } else {
+            // Choose an arbitrary vector that is not parallel to the normal
+            const Eigen::Vector3f up = std::abs(normal.z()) < 0.99F
+                                           ? Eigen::Vector3f::UnitZ()
+                                           : Eigen::Vector3f::UnitY();
+            t = normal.cross(up).normalized();
+        }
+        const Eigen::Vector3f bitangent = normal.cross(t);
+
+        Eigen::Matrix3f tbn;
+        tbn << t, bitangent, normal;
+        return tbn;
+    }
+};
+
+#endif
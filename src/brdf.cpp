@@ -9,9 +9,7 @@
 
 #include <Eigen/Dense>
 #include <numbers>
-
-#include "geometry/Geometry.h"
-#include "util/random.h"
+#include <tuple>
 
 namespace {
 
@@ -30,24 +28,6 @@ static constexpr float pow5(const float x) {
     return x2 * x2 * x;
 }
 
-/**
- * Transform a vector from tangent space to world space given the normal.
- */
-static Eigen::Vector3f from_tangent_space(const Eigen::Vector3f& vector,
-                                          const Eigen::Vector3f& normal) {
-    // https://learnopengl.com/Advanced-Lighting/Normal-Mapping
-
-    // Choose an arbitrary vector that is not parallel to the normal
-    const Eigen::Vector3f up = std::abs(normal.z()) < 0.99F
-                                   ? Eigen::Vector3f::UnitZ()
-                                   : Eigen::Vector3f::UnitY();
-    const Eigen::Vector3f tangent = normal.cross(up).normalized();
-    const Eigen::Vector3f bitangent = normal.cross(tangent).normalized();
-    Eigen::Matrix3f tbn;
-    tbn << tangent, bitangent, normal;
-    return tbn * vector;
-}
-
 static Eigen::Vector3f spherical_to_cartesian(const float theta,
                                               const float phi) {
     return {
@@ -71,10 +51,10 @@ static std::tuple<float, float> weight_diffuse_specular(
 }  // namespace
 
 Eigen::Vector3f brdf(const Ray& view_to_surface, const Ray& surface_to_light,
-                     const Intersection& view_intersection,
-                     const Eigen::Vector3f& normal,
-                     const Eigen::Vector2f& texcoords) {
-    const auto& material = view_intersection.object->material;
+                     const SurfaceInteraction& surface) {
+    const Material* const material = surface.material;
+    const Eigen::Vector3f& normal = surface.normal;
+    const Eigen::Vector2f& texcoords = surface.texcoords;
 
     const Eigen::Vector3f mat_diffuse = material->diffuse->sample(texcoords);
     const float mat_roughness = material->roughness->sample(texcoords);
@@ -116,24 +96,22 @@ Eigen::Vector3f brdf(const Ray& view_to_surface, const Ray& surface_to_light,
     return diffuse + specular;
 }
 
-Ray brdf_sample(const Ray& view_to_surface,
-                const Intersection& view_intersection,
-                const Eigen::Vector3f& surface_point,
-                const Eigen::Vector3f& normal,
-                const Eigen::Vector2f& texcoords) {
-    const auto& material = view_intersection.object->material;
+Ray brdf_sample(const Ray& view_to_surface, const SurfaceInteraction& surface,
+                Random& rng) {
+    const Material* const material = surface.material;
+    const Eigen::Vector3f& normal = surface.normal;
+    const Eigen::Vector2f& texcoords = surface.texcoords;
 
     const auto sample_diffuse = [&]() -> Eigen::Vector3f {
         // Cosine-weighted hemisphere sampling
         // https://ameye.dev/notes/sampling-the-hemisphere/
-        std::uniform_real_distribution<float> uniform_dist(0.F, 1.F);
-        const float r1 = uniform_dist(rng);
-        const float r2 = uniform_dist(rng);
+        const float r1 = rng.uniform();
+        const float r2 = rng.uniform();
 
         const float theta = std::acos(std::sqrt(1 - r1));
         const float phi = 2 * PI * r2;
 
-        return from_tangent_space(spherical_to_cartesian(theta, phi), normal);
+        return surface.tangent_space * spherical_to_cartesian(theta, phi);
     };
 
     const auto sample_specular = [&]() -> Eigen::Vector3f {
@@ -141,16 +119,15 @@ Ray brdf_sample(const Ray& view_to_surface,
 
         // Importance sampling for GGX distribution
         // https://agraphicsguynotes.com/posts/sample_microfacet_brdf/
-        std::uniform_real_distribution<float> uniform_dist(0.F, 1.F);
-        const float r1 = uniform_dist(rng);
-        const float r2 = uniform_dist(rng);
+        const float r1 = rng.uniform();
+        const float r2 = rng.uniform();
 
         const float a = pow2(roughness);  // a = roughness^2
         const float theta = std::atan(a * std::sqrt(r1 / (1 - r1)));
         const float phi = 2 * PI * r2;
 
-        const auto h =
-            from_tangent_space(spherical_to_cartesian(theta, phi), normal);
+        const Eigen::Vector3f h =
+            surface.tangent_space * spherical_to_cartesian(theta, phi);
 
         const auto v = -view_to_surface.direction;
         const auto direction = (2 * h.dot(v) * h - v).normalized();
@@ -163,22 +140,21 @@ Ray brdf_sample(const Ray& view_to_surface,
         diffuse, metallic, normal.dot(-view_to_surface.direction));
 
     Eigen::Vector3f direction;
-    std::uniform_real_distribution<float> uniform_dist(0.F, 1.F);
-    const float r = uniform_dist(rng);
+    const float r = rng.uniform();
     if (r < weight_specular) {
         direction = sample_specular();
     } else {
         direction = sample_diffuse();
     }
 
-    return {surface_point, direction};
+    return {surface.point, direction};
 }
 
 float brdf_pdf(const Ray& view_to_surface, const Ray& surface_to_light,
-               const Intersection& view_intersection,
-               const Eigen::Vector3f& normal,
-               const Eigen::Vector2f& texcoords) {
-    const auto& material = view_intersection.object->material;
+               const SurfaceInteraction& surface) {
+    const Material* const material = surface.material;
+    const Eigen::Vector3f& normal = surface.normal;
+    const Eigen::Vector2f& texcoords = surface.texcoords;
     const Eigen::Vector3f diffuse = material->diffuse->sample(texcoords);
     const float roughness = material->roughness->sample(texcoords);
     const float metallic = material->metallic->sample(texcoords);
@@ -1,8 +1,12 @@
 #include "AABB.h"
 
+#include <limits>
+
 AABB::AABB()
-    : min_corner(Eigen::Vector3f::Constant(Eigen::Infinity)),
-      max_corner(Eigen::Vector3f::Constant(-Eigen::Infinity)) {}
+    : min_corner(
+          Eigen::Vector3f::Constant(std::numeric_limits<float>::infinity())),
+      max_corner(
+          Eigen::Vector3f::Constant(-std::numeric_limits<float>::infinity())) {}
 
 AABB::AABB(Eigen::Vector3f min_corner, Eigen::Vector3f max_corner)
     : min_corner(std::move(min_corner)), max_corner(std::move(max_corner)) {}
@@ -16,16 +20,8 @@ Eigen::Vector3f AABB::center() const { return (min_corner + max_corner) / 2; }
 
 Eigen::Vector3f AABB::dimensions() const { return max_corner - min_corner; }
 
-bool AABB::intersect(const Ray& ray) const {
-    // As tested, leaving auto to lazy evaluate is faster.
-    const auto t1 = (min_corner - ray.origin).cwiseProduct(ray.inv_direction);
-    const auto t2 = (max_corner - ray.origin).cwiseProduct(ray.inv_direction);
-
-    const auto t_min_vec = t1.cwiseMin(t2);
-    const auto t_max_vec = t1.cwiseMax(t2);
-
-    const float t_min = std::max(t_min_vec.maxCoeff(), ray.min_t);
-    const float t_max = std::min(t_max_vec.minCoeff(), ray.max_t);
-
-    return t_min <= t_max;
+float AABB::surface_area() const {
+    const Eigen::Vector3f d = dimensions();
+    if ((d.array() < 0).any()) return 0.F;  // empty box
+    return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
 }
@@ -2,6 +2,7 @@
 #define AABB_H
 
 #include <Eigen/Core>
+#include <algorithm>
 
 #include "../Ray.h"
 
@@ -24,10 +25,26 @@ class AABB {
 
     [[nodiscard]] Eigen::Vector3f center() const;
     [[nodiscard]] Eigen::Vector3f dimensions() const;
+    [[nodiscard]] float surface_area() const;
     [[nodiscard]] bool intersect(const Ray& ray) const;
 
     Eigen::Vector3f min_corner;
     Eigen::Vector3f max_corner;
 };
 
+// Defined in the header so that it can be inlined into the BVH traversal.
+inline bool AABB::intersect(const Ray& ray) const {
+    // As tested, leaving auto to lazy evaluate is faster.
+    const auto t1 = (min_corner - ray.origin).cwiseProduct(ray.inv_direction);
+    const auto t2 = (max_corner - ray.origin).cwiseProduct(ray.inv_direction);
+
+    const auto t_min_vec = t1.cwiseMin(t2);
+    const auto t_max_vec = t1.cwiseMax(t2);
+
+    const float t_min = std::max(t_min_vec.maxCoeff(), ray.min_t);
+    const float t_max = std::min(t_max_vec.minCoeff(), ray.max_t);
+
+    return t_min <= t_max;
+}
+
 #endif
@@ -1,81 +1,1066 @@
 #include "AABBTree.h"
 
+#include <omp.h>
+
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+
+#include "../util/FileCache.h"
+#include "../util/hash.h"
+#include "morton.h"
+
+namespace {
+
+using PrimitiveIter = std::vector<AABBTree::BuildPrimitive>::iterator;
+
+// Maximum depth of the tree, bounded by the traversal stack size.
+static const unsigned int MAX_DEPTH = 64;
+// Depth after which the builders fall back to median splits, so that the
+// remaining depth is at most log2 of the number of primitives.
+static const unsigned int MAX_SPLIT_DEPTH = 32;
+// Maximum number of bins per axis of the SAH builder.
+static const size_t MAX_SAH_BINS = 64;
+// Minimum number of primitives of a subtree built in a separate task.
+static const size_t TASK_THRESHOLD = 4096;
+// Minimum number of primitives of a node whose bounds and bins are reduced in
+// parallel tasks. Only the top levels of the tree are that large.
+static const size_t PARALLEL_REDUCE_THRESHOLD = 65536;
+// Version of the cached trees, to be increased when the builders change.
+static const uint32_t CACHE_VERSION = 1;
+
+struct Split {
+    // First primitive of the right side.
+    PrimitiveIter mid;
+    // Axis along which the primitives are split.
+    int axis;
+};
+
+/**
+ * Get whether each component of the direction of a ray is negative. The
+ * inverse is tested, so that a component of -0, whose inverse is -infinity,
+ * is negative too. std::signbit() cannot be used, since -ffast-math assumes
+ * that the sign of zeros does not matter.
+ */
+static std::array<bool, 3> direction_signs(const Ray& ray) {
+    return {ray.inv_direction.x() < 0, ray.inv_direction.y() < 0,
+            ray.inv_direction.z() < 0};
+}
+
+static int longest_axis(const Eigen::Vector3f& dimensions) {
+    int axis = 0;
+    if (dimensions(1) > dimensions(axis)) axis = 1;
+    if (dimensions(2) > dimensions(axis)) axis = 2;
+    return axis;
+}
+
+/**
+ * Reduce the primitives in [begin, end) to a value. Large ranges are split
+ * into one chunk per thread, reduced in parallel tasks, and the partial
+ * values are then combined in order.
+ *
+ * @param init Initial value of each chunk.
+ * @param accumulate Callable adding a primitive to a value.
+ * @param combine Callable adding a partial value to a value.
+ * @return The reduced value.
+ */
+template <typename T, typename Accumulate, typename Combine>
+static T reduce_primitives(const PrimitiveIter begin, const PrimitiveIter end,
+                           const T& init, const Accumulate& accumulate,
+                           const Combine& combine) {
+    const auto count = static_cast<size_t>(end - begin);
+    const auto num_chunks = count >= PARALLEL_REDUCE_THRESHOLD
+                                ? static_cast<size_t>(omp_get_num_threads())
+                                : 1;
+
+    if (num_chunks == 1) {
+        T result = init;
+        for (auto it = begin; it != end; it++) accumulate(result, *it);
+        return result;
+    }
+
+    std::vector<T> partials(num_chunks, init);
+    for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+#pragma omp task default(shared) firstprivate(chunk)
+        {
+            const size_t chunk_begin = count * chunk / num_chunks;
+            const size_t chunk_end = count * (chunk + 1) / num_chunks;
+            for (auto it = begin + static_cast<std::ptrdiff_t>(chunk_begin);
+                 it != begin + static_cast<std::ptrdiff_t>(chunk_end); it++) {
+                accumulate(partials[chunk], *it);
+            }
+        }
+    }
+#pragma omp taskwait
+
+    T result = init;
+    for (const T& partial : partials) combine(result, partial);
+    return result;
+}
+
+static bool is_triangle(const AABBTree::BuildPrimitive& prim) {
+    return prim.primitive.type() == AABBTree::PrimitiveType::Triangle;
+}
+
+/**
+ * Estimate the cost of intersecting the primitives of a leaf, where the
+ * triangles are intersected as many at a time as the SIMD width.
+ *
+ * @param count Number of primitives.
+ * @param triangles Number of triangles among them.
+ * @param options Options controlling the builder.
+ */
+static float leaf_cost(const size_t count, const size_t triangles,
+                       const BVHOptions& options) {
+    const size_t width = simd_width(options.simd);
+    const size_t batches = (triangles + width - 1) / width + count - triangles;
+    return options.intersection_cost * static_cast<float>(batches);
+}
+
+/**
+ * Split the primitives evenly at the median of their centers along an axis.
+ */
+static Split split_median(const PrimitiveIter begin, const PrimitiveIter end,
+                          const int axis) {
+    const auto compare_center = [axis](const AABBTree::BuildPrimitive& a,
+                                       const AABBTree::BuildPrimitive& b) {
+        return a.bounding_box.center()(axis) < b.bounding_box.center()(axis);
+    };
+
+    const auto mid = begin + (end - begin) / 2;
+    std::nth_element(begin, mid, end, compare_center);
+    return {mid, axis};
+}
+
+/**
+ * Split the primitives at the spatial midpoint of the longest axis of their
+ * bounding box. Degenerates to an even split if one side would be empty.
+ *
+ * @param begin, end Primitives to split. They are partitioned in place.
+ * @param bounding_box Bounding box of all the primitives.
+ * @param options Options controlling the builder.
+ * @return The split, or std::nullopt if the primitives should be kept in a
+ * leaf.
+ */
+static std::optional<Split> split_midpoint(const PrimitiveIter begin,
+                                           const PrimitiveIter end,
+                                           const AABB& bounding_box,
+                                           const BVHOptions& options) {
+    if (end - begin <= std::max(options.max_leaf_size, 1U)) {
+        return std::nullopt;
+    }
+
+    const int axis = longest_axis(bounding_box.dimensions());
+    const float mid =
+        (bounding_box.min_corner(axis) + bounding_box.max_corner(axis)) / 2;
+
+    const auto mid_iter =
+        std::partition(begin, end, [axis, mid](const auto& prim) {
+            return prim.bounding_box.center()(axis) < mid;
+        });
+
+    if (mid_iter == begin || mid_iter == end) {
+        // degenerate to even split if one side is empty
+        return split_median(begin, end, axis);
+    }
+
+    return Split{mid_iter, axis};
+}
+
+/**
+ * Split the primitives with the binned surface area heuristic (SAH). The
+ * centroids are binned along each axis, and the bin boundary with the lowest
+ * estimated traversal cost is chosen.
+ *
+ * Reference:
+ * https://www.sci.utah.edu/~wald/Publications/2007/ParallelBVHBuild/fastbuild.pdf
+ *
+ * @param begin, end Primitives to split. They are partitioned in place.
+ * @param bounding_box Bounding box of all the primitives.
+ * @param options Options controlling the builder.
+ * @return The split, or std::nullopt if the primitives should be kept in a
+ * leaf.
+ */
+static std::optional<Split> split_sah(const PrimitiveIter begin,
+                                      const PrimitiveIter end,
+                                      const AABB& bounding_box,
+                                      const BVHOptions& options) {
+    const auto count = static_cast<size_t>(end - begin);
+    const size_t max_leaf_size = std::max(options.max_leaf_size, 1U);
+
+    struct CentroidBounds {
+        AABB bounding_box;
+        size_t triangles = 0;
+    };
+    const CentroidBounds bounds = reduce_primitives(
+        begin, end, CentroidBounds{},
+        [](CentroidBounds& bounds, const AABBTree::BuildPrimitive& prim) {
+            const Eigen::Vector3f center = prim.bounding_box.center();
+            bounds.bounding_box.merge(AABB(center, center));
+            if (is_triangle(prim)) bounds.triangles++;
+        },
+        [](CentroidBounds& bounds, const CentroidBounds& other) {
+            bounds.bounding_box.merge(other.bounding_box);
+            bounds.triangles += other.triangles;
+        });
+    const AABB& centroid_bounds = bounds.bounding_box;
+    const size_t triangles = bounds.triangles;
+    const Eigen::Vector3f extent = centroid_bounds.dimensions();
+
+    if (extent.maxCoeff() <= 0.F) {
+        // All centroids coincide, so no split can separate them.
+        if (count <= max_leaf_size) return std::nullopt;
+        return Split{begin + static_cast<std::ptrdiff_t>(count / 2), 0};
+    }
+
+    struct Bin {
+        AABB bounding_box;
+        size_t count = 0;
+        size_t triangles = 0;
+    };
+
+    using AxisBins = std::array<Bin, MAX_SAH_BINS>;
+
+    const size_t num_bins =
+        std::clamp<size_t>(options.sah_bins, 2, MAX_SAH_BINS);
+    const auto bin_index = [&](const AABBTree::BuildPrimitive& prim,
+                               const int axis) -> size_t {
+        const float offset = prim.bounding_box.center()(axis) -
+                             centroid_bounds.min_corner(axis);
+        const auto index = static_cast<size_t>(
+            offset / extent(axis) * static_cast<float>(num_bins));
+        return std::min(index, num_bins - 1);
+    };
+
+    const float node_area = bounding_box.surface_area();
+    const float inv_node_area = node_area > 0.F ? 1.F / node_area : 0.F;
+
+    float best_cost = std::numeric_limits<float>::infinity();
+    int best_axis = -1;
+    size_t best_split = 0;
+
+    // Bin the primitives along all the axes in a single pass.
+    const std::array<AxisBins, 3> all_bins = reduce_primitives(
+        begin, end, std::array<AxisBins, 3>{},
+        [&](std::array<AxisBins, 3>& bins,
+            const AABBTree::BuildPrimitive& prim) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (extent(axis) <= 0.F) continue;
+                Bin& bin = bins[axis][bin_index(prim, axis)];
+                bin.bounding_box.merge(prim.bounding_box);
+                bin.count++;
+                if (is_triangle(prim)) bin.triangles++;
+            }
+        },
+        [&](std::array<AxisBins, 3>& bins,
+            const std::array<AxisBins, 3>& other) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (size_t i = 0; i < num_bins; i++) {
+                    bins[axis][i].bounding_box.merge(
+                        other[axis][i].bounding_box);
+                    bins[axis][i].count += other[axis][i].count;
+                    bins[axis][i].triangles += other[axis][i].triangles;
+                }
+            }
+        });
+
+    std::array<float, MAX_SAH_BINS> right_areas;
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent(axis) <= 0.F) continue;
+        const AxisBins& bins = all_bins[axis];
+
+        // Sweep from the right to accumulate the areas of the right sides.
+        AABB right_box;
+        for (size_t i = num_bins - 1; i > 0; i--) {
+            right_box.merge(bins[i].bounding_box);
+            right_areas[i] = right_box.surface_area();
+        }
+
+        // Sweep from the left and evaluate the split before each bin.
+        AABB left_box;
+        size_t left_count = 0;
+        size_t left_triangles = 0;
+        for (size_t i = 1; i < num_bins; i++) {
+            left_box.merge(bins[i - 1].bounding_box);
+            left_count += bins[i - 1].count;
+            left_triangles += bins[i - 1].triangles;
+            const size_t right_count = count - left_count;
+            if (left_count == 0 || right_count == 0) continue;
+
+            const float cost =
+                options.traversal_cost +
+                inv_node_area *
+                    (left_box.surface_area() *
+                         leaf_cost(left_count, left_triangles, options) +
+                     right_areas[i] * leaf_cost(right_count,
+                                                triangles - left_triangles,
+                                                options));
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = i;
+            }
+        }
+    }
+
+    if (count <= max_leaf_size &&
+        leaf_cost(count, triangles, options) <= best_cost) {
+        return std::nullopt;
+    }
+    assert(best_axis != -1);
 
-AABBTree::AABBTree(std::vector<std::unique_ptr<Geometry>> objects) {
-    assert(objects.size() >= 2);
+    const auto mid = std::partition(begin, end, [&](const auto& prim) {
+        return bin_index(prim, best_axis) < best_split;
+    });
+    return Split{mid, best_axis};
+}
+
+/**
+ * Split primitives sorted by Morton code at the highest bit that differs
+ * between their codes, which is a spatial midpoint split along the axis of
+ * that bit. The primitives stay in Morton order.
+ *
+ * Reference:
+ * https://research.nvidia.com/sites/default/files/pubs/2012-06_Maximizing-Parallelism-in/karras2012hpg_paper.pdf
+ *
+ * @param begin, end Primitives to split, sorted by Morton code.
+ * @param codes Morton codes of the primitives.
+ * @param options Options controlling the builder.
+ * @return The split, or std::nullopt if the primitives should be kept in a
+ * leaf.
+ */
+static std::optional<Split> split_morton(const PrimitiveIter begin,
+                                         const PrimitiveIter end,
+                                         const uint64_t* const codes,
+                                         const BVHOptions& options) {
+    const auto count = static_cast<size_t>(end - begin);
+    if (count <= std::max(options.max_leaf_size, 1U)) return std::nullopt;
+
+    const uint64_t first_code = codes[0];
+    const uint64_t last_code = codes[count - 1];
+    if (first_code == last_code) {
+        // The primitives cannot be told apart, so split them evenly.
+        return Split{begin + static_cast<std::ptrdiff_t>(count / 2), 0};
+    }
+
+    // The codes of the range share the bits above the highest differing bit,
+    // and that bit is 0 in the first part and 1 in the second part.
+    const int bit = std::bit_width(first_code ^ last_code) - 1;
+    const uint64_t mask = uint64_t{1} << bit;
+    const auto mid =
+        std::partition_point(codes, codes + count, [mask](const uint64_t code) {
+            return (code & mask) == 0;
+        });
+    return Split{begin + (mid - codes), 2 - bit % 3};
+}
+
+/**
+ * Sort the primitives by the Morton codes of the centers of their bounding
+ * boxes, quantized within the bounds of the centers.
+ *
+ * @param primitives Primitives to sort in place.
+ * @return Morton codes of the sorted primitives.
+ */
+static std::vector<uint64_t> sort_by_morton_code(
+    std::vector<AABBTree::BuildPrimitive>& primitives) {
+    AABB centroid_bounds;
+    for (const auto& prim : primitives) {
+        const Eigen::Vector3f center = prim.bounding_box.center();
+        centroid_bounds.merge(AABB(center, center));
+    }
+    const Eigen::Vector3f scale =
+        centroid_bounds.dimensions().cwiseMax(1e-30F).cwiseInverse();
 
-    for (const auto& obj : objects) {
-        bounding_box.merge(obj->bounding_box);
+    std::vector<MortonKey> keys(primitives.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const Eigen::Vector3f point =
+            (primitives[i].bounding_box.center() - centroid_bounds.min_corner)
+                .cwiseProduct(scale);
+        keys[i] = {morton_code(point), static_cast<uint32_t>(i)};
     }
-    const Eigen::Vector3f dimensions = bounding_box.dimensions();
 
-    int longest_axis = 0;
-    if (dimensions(1) > dimensions(longest_axis)) longest_axis = 1;
-    if (dimensions(2) > dimensions(longest_axis)) longest_axis = 2;
+    radix_sort(keys);
 
-    const float mid = (bounding_box.min_corner(longest_axis) +
-                       bounding_box.max_corner(longest_axis)) /
-                      2;
+    std::vector<AABBTree::BuildPrimitive> sorted_primitives;
+    sorted_primitives.reserve(primitives.size());
+    std::vector<uint64_t> codes(primitives.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        sorted_primitives.push_back(primitives[keys[i].index]);
+        codes[i] = keys[i].code;
+    }
+    primitives = std::move(sorted_primitives);
+    return codes;
+}
 
-    std::vector<std::unique_ptr<Geometry>> objs_left;
-    std::vector<std::unique_ptr<Geometry>> objs_right;
+}  // namespace
 
-    for (auto& obj : objects) {
-        if (obj->bounding_box.center()(longest_axis) < mid) {
-            objs_left.push_back(std::move(obj));
+AABBTree::AABBTree(std::vector<std::unique_ptr<Geometry>> objects,
+                   const BVHOptions& options)
+    : objects(std::move(objects)) {
+    // Register each object in the array of its type. The primitives of an
+    // object are referenced like the object, with their own index.
+    std::vector<Primitive> object_refs;
+    object_refs.reserve(this->objects.size());
+    for (const auto& object : this->objects) {
+        PrimitiveType type = PrimitiveType::Generic;
+        uint32_t typed_index = 0;
+        switch (object->type) {
+            case GeometryType::TriangleMesh:
+                type = PrimitiveType::Triangle;
+                typed_index = static_cast<uint32_t>(meshes.size());
+                meshes.push_back(
+                    static_cast<const TriangleMesh*>(object.get()));
+                break;
+            case GeometryType::Sphere:
+                type = PrimitiveType::Sphere;
+                typed_index = static_cast<uint32_t>(spheres.size());
+                spheres.push_back(static_cast<const Sphere*>(object.get()));
+                break;
+            default:
+                typed_index = static_cast<uint32_t>(generic_objects.size());
+                generic_objects.push_back(object.get());
+                break;
+        }
+        assert(typed_index <= Primitive::OBJECT_MASK);
+        object_refs.emplace_back(type, typed_index, 0);
+    }
+
+    const std::optional<uint64_t> key = cache_key(object_refs, options);
+    if (!key || !read_tree(options.cache_file, *key)) {
+        build_tree(object_refs, options);
+        if (key) write_tree(options.cache_file, *key);
+    }
+
+    if (options.simd != SimdLevel::Scalar) {
+        intersect_packet = packet_intersector(options.simd);
+        intersect_children = children_intersector(options.simd);
+    }
+    if (options.collect_stats) {
+        thread_counters.resize(static_cast<size_t>(omp_get_max_threads()));
+    }
+
+    bounding_box = nodes[0].bounding_box;
+}
+
+void AABBTree::build_tree(const std::vector<Primitive>& object_refs,
+                          const BVHOptions& options) {
+    size_t num_primitives = 0;
+    for (const auto& object : objects) {
+        num_primitives += object->num_primitives();
+    }
+
+    // The bounding boxes are computed in parallel once all the primitives
+    // are listed.
+    std::vector<BuildPrimitive> build_primitives;
+    build_primitives.reserve(num_primitives);
+    for (const Primitive& object_ref : object_refs) {
+        const Geometry& object = geometry_of(object_ref);
+        for (uint32_t j = 0; j < object.num_primitives(); j++) {
+            build_primitives.push_back(
+                {AABB(), Primitive(object_ref.type(), object_ref.object(), j)});
+        }
+    }
+    if (build_primitives.empty()) {
+        throw std::invalid_argument("AABBTree needs at least one primitive.");
+    }
+
+#pragma omp parallel for
+    for (size_t i = 0; i < build_primitives.size(); i++) {
+        const Primitive& primitive = build_primitives[i].primitive;
+        build_primitives[i].bounding_box =
+            geometry_of(primitive).primitive_bounding_box(primitive.index);
+    }
+
+    std::vector<uint64_t> morton_codes;
+    if (options.builder == BVHBuilder::LBVH) {
+        morton_codes = sort_by_morton_code(build_primitives);
+    }
+
+    // The subtrees are built in parallel tasks, allocating the nodes in the
+    // order they are built. They are then laid out in depth-first order.
+    BuildNodes build_nodes(2 * build_primitives.size() - 1);
+    const BuildContext context = {
+        .build_nodes = build_nodes,
+        .first = build_primitives.begin(),
+        .morton_codes = morton_codes,
+        .options = options,
+    };
+#pragma omp parallel
+#pragma omp single
+    build(context, build_primitives.begin(), build_primitives.end(),
+          build_nodes.allocate(1), 0);
+    nodes.reserve(build_nodes.size());
+    compact(build_nodes, 0);
+
+    primitives.reserve(build_primitives.size());
+    for (const BuildPrimitive& build_primitive : build_primitives) {
+        primitives.push_back(build_primitive.primitive);
+    }
+
+    if (options.simd != SimdLevel::Scalar) {
+        pack_triangles();
+        collapse(0, simd_width(options.simd));
+        wide_nodes.shrink_to_fit();
+    }
+}
+
+std::optional<uint64_t> AABBTree::cache_key(
+    const std::vector<Primitive>& object_refs,
+    const BVHOptions& options) const {
+    // Generic objects cannot be hashed.
+    if (options.cache_file.empty() || !generic_objects.empty()) {
+        return std::nullopt;
+    }
+
+    Hasher hasher;
+    hasher.update(CACHE_VERSION);
+    hasher.update(sizeof(Node));
+    hasher.update(sizeof(WideNode));
+    hasher.update(sizeof(TrianglePacket));
+    hasher.update(options.builder);
+    hasher.update(options.sah_bins);
+    hasher.update(options.traversal_cost);
+    hasher.update(options.intersection_cost);
+    hasher.update(options.max_leaf_size);
+    hasher.update(options.simd);
+
+    for (const Primitive& object_ref : object_refs) {
+        hasher.update(object_ref.tagged_object);
+        if (object_ref.type() == PrimitiveType::Triangle) {
+            const TriangleMesh& mesh = *meshes[object_ref.object()];
+            hasher.update(mesh.positions);
+            hasher.update(mesh.indices);
         } else {
-            objs_right.push_back(std::move(obj));
+            const Sphere& sphere = *spheres[object_ref.object()];
+            hasher.update(sphere.center);
+            hasher.update(sphere.radius);
         }
     }
+    return hasher.digest();
+}
+
+bool AABBTree::read_tree(const std::filesystem::path& path,
+                         const uint64_t key) {
+    const bool read = read_cache(path, key, [&](BinaryReader& reader) {
+        return reader.read(nodes) && !nodes.empty() &&
+               reader.read(wide_nodes) && reader.read(primitives) &&
+               reader.read(packets);
+    });
+    if (!read) {
+        nodes.clear();
+        wide_nodes.clear();
+        primitives.clear();
+        packets.clear();
+    }
+    return read;
+}
 
-    if (objs_left.size() == 0 || objs_right.size() == 0) {
-        // degenerate to even split if one side is empty
+void AABBTree::write_tree(const std::filesystem::path& path,
+                          const uint64_t key) const {
+    // The key covers the primitives, so the tree has no source files.
+    write_cache(path, key, {}, [&](BinaryWriter& writer) {
+        writer.write(nodes);
+        writer.write(wide_nodes);
+        writer.write(primitives);
+        writer.write(packets);
+    });
+}
 
-        const auto compare_center = [longest_axis](
-                                        const std::unique_ptr<Geometry>& a,
-                                        const std::unique_ptr<Geometry>& b) {
-            const float a_center = (a->bounding_box.min_corner(longest_axis) +
-                                    a->bounding_box.max_corner(longest_axis)) /
-                                   2;
-            const float b_center = (b->bounding_box.min_corner(longest_axis) +
-                                    b->bounding_box.max_corner(longest_axis)) /
-                                   2;
-            return a_center < b_center;
-        };
-
-        std::vector<std::unique_ptr<Geometry>> objs =
-            objs_left.size() != 0 ? std::move(objs_left)
-                                  : std::move(objs_right);
-
-        const auto mid_iter =
-            objs.begin() + static_cast<std::ptrdiff_t>(objs.size() / 2);
-        std::nth_element(objs.begin(), mid_iter, objs.end(), compare_center);
-
-        objs_left.clear();
-        objs_left.insert(objs_left.end(), std::make_move_iterator(objs.begin()),
-                         std::make_move_iterator(mid_iter));
-        objs_right.clear();
-        objs_right.insert(objs_right.end(), std::make_move_iterator(mid_iter),
-                          std::make_move_iterator(objs.end()));
-    }
-    assert(objs_left.size() > 0 && objs_right.size() > 0);
-
-    left = (objs_left.size() == 1)
-               ? std::move(objs_left[0])
-               : std::make_unique<AABBTree>(std::move(objs_left));
-    right = (objs_right.size() == 1)
-                ? std::move(objs_right[0])
-                : std::make_unique<AABBTree>(std::move(objs_right));
+const Geometry& AABBTree::geometry_of(const Primitive& primitive) const {
+    switch (primitive.type()) {
+        case PrimitiveType::Triangle:
+            return *meshes[primitive.object()];
+        case PrimitiveType::Sphere:
+            return *spheres[primitive.object()];
+        default:
+            return *generic_objects[primitive.object()];
+    }
+}
+
+void AABBTree::build(const BuildContext& context, const PrimitiveIter begin,
+                     const PrimitiveIter end, const uint32_t index,
+                     const unsigned int depth) {
+    const BVHOptions& options = context.options;
+    Node& node = context.build_nodes[index];
+
+    const AABB node_box = reduce_primitives(
+        begin, end, AABB(),
+        [](AABB& box, const BuildPrimitive& prim) {
+            box.merge(prim.bounding_box);
+        },
+        [](AABB& box, const AABB& other) { box.merge(other); });
+    node.bounding_box = node_box;
+
+    const auto count = static_cast<size_t>(end - begin);
+    const size_t max_leaf_size =
+        std::clamp<size_t>(options.max_leaf_size, 1, UINT16_MAX);
+
+    // Split the primitives evenly. The LBVH builder keeps them in Morton
+    // order, which its splits rely on.
+    const auto split_even = [&]() {
+        const int axis = longest_axis(node_box.dimensions());
+        if (options.builder == BVHBuilder::LBVH) {
+            return Split{begin + static_cast<std::ptrdiff_t>(count / 2), axis};
+        }
+        return split_median(begin, end, axis);
+    };
+
+    std::optional<Split> split;
+    if (count == 1) {
+        split = std::nullopt;
+    } else if (depth >= MAX_SPLIT_DEPTH) {
+        if (count > max_leaf_size) split = split_even();
+    } else if (options.builder == BVHBuilder::SAH) {
+        split = split_sah(begin, end, node_box, options);
+    } else if (options.builder == BVHBuilder::LBVH) {
+        split = split_morton(
+            begin, end, &context.morton_codes[begin - context.first], options);
+    } else {
+        split = split_midpoint(begin, end, node_box, options);
+    }
+
+    if (!split && count > UINT16_MAX) {
+        // The primitive count does not fit in a leaf.
+        split = split_even();
+    }
+
+    if (!split) {
+        node.offset = static_cast<uint32_t>(begin - context.first);
+        node.count = static_cast<uint16_t>(count);
+        return;
+    }
+    assert(split->mid != begin && split->mid != end);
+    assert(depth + 1 < MAX_DEPTH);
+
+    const uint32_t left = context.build_nodes.allocate(2);
+    const uint32_t right = left + 1;
+    node.offset = left;
+    node.count = 0;
+    node.axis = static_cast<uint8_t>(split->axis);
+
+    const PrimitiveIter mid = split->mid;
+    if (static_cast<size_t>(mid - begin) >= TASK_THRESHOLD) {
+        // The left subtree is left to another thread, if any is idle.
+#pragma omp task default(shared)
+        build(context, begin, mid, left, depth + 1);
+        build(context, mid, end, right, depth + 1);
+#pragma omp taskwait
+    } else {
+        build(context, begin, mid, left, depth + 1);
+        build(context, mid, end, right, depth + 1);
+    }
+}
+
+AABBTree::BuildNodes::BuildNodes(const size_t max_nodes)
+    : blocks((max_nodes + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+    assert(max_nodes <= UINT32_MAX);
+}
+
+AABBTree::BuildNodes::~BuildNodes() {
+    for (std::atomic<Node*>& block : blocks) delete[] block.load();
+}
+
+uint32_t AABBTree::BuildNodes::allocate(const uint32_t count) {
+    const uint32_t first =
+        num_nodes.fetch_add(count, std::memory_order_relaxed);
+    const uint32_t last = first + count - 1;
+    assert((last >> BLOCK_BITS) < blocks.size());
+
+    // Allocate the blocks of the nodes, unless another thread already did.
+    for (uint32_t b = first >> BLOCK_BITS; b <= last >> BLOCK_BITS; b++) {
+        if (blocks[b].load(std::memory_order_acquire) != nullptr) continue;
+        auto block = std::make_unique<Node[]>(BLOCK_SIZE);
+        Node* expected = nullptr;
+        if (blocks[b].compare_exchange_strong(expected, block.get(),
+                                              std::memory_order_acq_rel)) {
+            block.release();
+        }
+    }
+    return first;
+}
+
+uint32_t AABBTree::compact(const BuildNodes& build_nodes,
+                           const uint32_t index) {
+    const auto compact_index = static_cast<uint32_t>(nodes.size());
+    const Node& node = build_nodes[index];
+    nodes.push_back(node);
+    if (node.count == 0) {
+        compact(build_nodes, node.offset);
+        nodes[compact_index].offset = compact(build_nodes, node.offset + 1);
+    }
+    return compact_index;
+}
+
+void AABBTree::pack_triangles() {
+    std::vector<Primitive> packed;
+    packed.reserve(primitives.size());
+
+    for (Node& node : nodes) {
+        if (node.count == 0) continue;
+        const auto begin = primitives.begin() + node.offset;
+        const auto end = begin + node.count;
+        const auto offset = static_cast<uint32_t>(packed.size());
+
+        unsigned int lane = TrianglePacket::WIDTH;
+        for (auto it = begin; it != end; it++) {
+            if (it->type() != PrimitiveType::Triangle) continue;
+            if (lane == TrianglePacket::WIDTH) {
+                assert(packets.size() <= Primitive::OBJECT_MASK);
+                packed.emplace_back(PrimitiveType::TrianglePacket,
+                                    static_cast<uint32_t>(packets.size()), 0);
+                packets.emplace_back();
+                lane = 0;
+            }
+            packets.back().set(lane++, it->object(), it->index,
+                               meshes[it->object()]->vertices_of(it->index));
+        }
+        std::copy_if(begin, end, std::back_inserter(packed),
+                     [](const Primitive& primitive) {
+                         return primitive.type() != PrimitiveType::Triangle;
+                     });
+
+        node.offset = offset;
+        node.count = static_cast<uint16_t>(packed.size() - offset);
+    }
+
+    primitives = std::move(packed);
+}
+
+uint32_t AABBTree::collapse(const uint32_t index, const unsigned int width) {
+    const auto wide_index = static_cast<uint32_t>(wide_nodes.size());
+    wide_nodes.emplace_back();
+
+    // Binary nodes becoming the children of the wide node.
+    std::array<uint32_t, WideNode::WIDTH> children;
+    unsigned int num_children = 0;
+    if (nodes[index].count == 0) {
+        children[num_children++] = index + 1;
+        children[num_children++] = nodes[index].offset;
+    } else {
+        // A leaf root becomes the only child.
+        children[num_children++] = index;
+    }
+
+    while (num_children < width) {
+        int largest = -1;
+        float largest_area = -1.F;
+        for (unsigned int i = 0; i < num_children; i++) {
+            const Node& child = nodes[children[i]];
+            if (child.count != 0) continue;
+            const float area = child.bounding_box.surface_area();
+            if (area > largest_area) {
+                largest = static_cast<int>(i);
+                largest_area = area;
+            }
+        }
+        if (largest == -1) break;
+
+        const uint32_t opened = children[largest];
+        children[largest] = opened + 1;
+        children[num_children++] = nodes[opened].offset;
+    }
+
+    for (unsigned int i = 0; i < num_children; i++) {
+        const Node& child = nodes[children[i]];
+        // Recurse before setting the child, as it reallocates the wide nodes.
+        const uint32_t target = child.count == 0
+                                    ? collapse(children[i], width)
+                                    : child.offset;
+        wide_nodes[wide_index].set(i, child.bounding_box, target, child.count);
+    }
+    wide_nodes[wide_index].num_children = num_children;
+
+    return wide_index;
+}
+
+Intersection AABBTree::primitive_intersect(const Primitive& primitive,
+                                           const Ray& ray) const {
+    switch (primitive.type()) {
+        case PrimitiveType::TrianglePacket: {
+            const TrianglePacket& packet = packets[primitive.object()];
+            const PacketHit hit = intersect_packet(packet, ray);
+            if (hit.lane < 0) return Intersection::NoIntersection();
+            const auto lane = static_cast<size_t>(hit.lane);
+            return {meshes[packet.object[lane]], hit.t,
+                    packet.primitive[lane], hit.u, hit.v};
+        }
+        case PrimitiveType::Triangle:
+            return meshes[primitive.object()]->intersect_primitive(
+                ray, primitive.index);
+        case PrimitiveType::Sphere:
+            return spheres[primitive.object()]->intersect(ray);
+        default:
+            return generic_objects[primitive.object()]->intersect_primitive(
+                ray, primitive.index);
+    }
+}
+
+bool AABBTree::primitive_occluded(const Primitive& primitive,
+                                  const Ray& ray) const {
+    switch (primitive.type()) {
+        case PrimitiveType::TrianglePacket:
+            return intersect_packet(packets[primitive.object()], ray).lane >= 0;
+        case PrimitiveType::Triangle:
+            return meshes[primitive.object()]
+                ->intersect_primitive(ray, primitive.index)
+                .has_intersection();
+        case PrimitiveType::Sphere:
+            return spheres[primitive.object()]->intersect(ray).has_intersection();
+        default:
+            return generic_objects[primitive.object()]->occluded_primitive(
+                ray, primitive.index);
+    }
+}
+
+std::vector<const Object*> AABBTree::emitters() const {
+    std::vector<const Object*> emitters;
+    for (const auto& object : objects) {
+        std::ranges::copy(object->emitters(), std::back_inserter(emitters));
+    }
+    return emitters;
+}
+
+std::vector<ThreadTraversalCounters> AABBTree::traversal_counters() const {
+    return thread_counters;
+}
+
+ThreadTraversalCounters& AABBTree::this_thread_counters() const {
+    const auto thread = static_cast<size_t>(omp_get_thread_num());
+    assert(thread < thread_counters.size());
+    return thread_counters[thread];
 }
 
 Intersection AABBTree::intersect(const Ray& ray) const {
-    if (!bounding_box.intersect(ray)) return Intersection::NoIntersection();
+    if (thread_counters.empty()) {
+        TraversalCounters unused;
+        return wide_nodes.empty() ? intersect_binary<false>(ray, unused)
+                                  : intersect_wide<false>(ray, unused);
+    }
+    TraversalCounters& counters = this_thread_counters().closest_hit;
+    counters.rays++;
+    return wide_nodes.empty() ? intersect_binary<true>(ray, counters)
+                              : intersect_wide<true>(ray, counters);
+}
+
+bool AABBTree::occluded(const Ray& ray) const {
+    if (thread_counters.empty()) {
+        TraversalCounters unused;
+        return wide_nodes.empty() ? occluded_binary<false>(ray, unused)
+                                  : occluded_wide<false>(ray, unused);
+    }
+    TraversalCounters& counters = this_thread_counters().any_hit;
+    counters.rays++;
+    return wide_nodes.empty() ? occluded_binary<true>(ray, counters)
+                              : occluded_wide<true>(ray, counters);
+}
+
+template <bool COUNT>
+Intersection AABBTree::intersect_binary(const Ray& ray,
+                                        TraversalCounters& counters) const {
+    Intersection hit;
+
+    // The far end of the ray is moved to the closest hit found so far, so that
+    // nodes and primitives behind it are culled.
+    Ray closest_ray = ray;
+    const std::array<bool, 3> direction_negative = direction_signs(ray);
+
+    // Far children to be visited.
+    std::array<uint32_t, MAX_DEPTH> stack;
+    size_t stack_size = 0;
+    uint32_t index = 0;
+
+    while (true) {
+        const Node& node = nodes[index];
+        if constexpr (COUNT) {
+            counters.nodes_visited++;
+            counters.box_tests++;
+        }
+
+        if (node.bounding_box.intersect(closest_ray)) {
+            if (node.count == 0) {
+                // Visit the near child first and the far child later.
+                if (direction_negative[node.axis]) {
+                    stack[stack_size++] = index + 1;
+                    index = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    index++;
+                }
+                continue;
+            }
+
+            if constexpr (COUNT) counters.primitive_tests += node.count;
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                const Intersection primitive_hit =
+                    primitive_intersect(primitives[i], closest_ray);
+                if (primitive_hit.has_intersection()) {
+                    hit = primitive_hit;
+                    closest_ray.max_t = hit.t;
+                }
+            }
+        }
+
+        if (stack_size == 0) break;
+        index = stack[--stack_size];
+    }
+
+    return hit;
+}
+
+template <bool COUNT>
+bool AABBTree::occluded_binary(const Ray& ray,
+                               TraversalCounters& counters) const {
+    // Children to be visited.
+    std::array<uint32_t, MAX_DEPTH> stack;
+    size_t stack_size = 0;
+    uint32_t index = 0;
+
+    while (true) {
+        const Node& node = nodes[index];
+        if constexpr (COUNT) {
+            counters.nodes_visited++;
+            counters.box_tests++;
+        }
+
+        if (node.bounding_box.intersect(ray)) {
+            if (node.count == 0) {
+                stack[stack_size++] = node.offset;
+                index++;
+                continue;
+            }
+
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+                if constexpr (COUNT) counters.primitive_tests++;
+                if (primitive_occluded(primitives[i], ray)) return true;
+            }
+        }
+
+        if (stack_size == 0) break;
+        index = stack[--stack_size];
+    }
+
+    return false;
+}
+
+namespace {
+
+/**
+ * A child of a wide node waiting to be visited.
+ */
+struct WideStackEntry {
+    // Index of the wide node, or of the first primitive of a leaf.
+    uint32_t child;
+    // Number of primitives of a leaf (0 for an inner node).
+    uint32_t count;
+    // Distance at which the ray enters the bounding box.
+    float distance;
+};
+
+}  // namespace
+
+template <bool COUNT>
+Intersection AABBTree::intersect_wide(const Ray& ray,
+                                      TraversalCounters& counters) const {
+    Intersection hit;
+
+    // The far end of the ray is moved to the closest hit found so far, so that
+    // nodes and primitives behind it are culled.
+    Ray closest_ray = ray;
+    const std::array<bool, 3> direction_negative = direction_signs(ray);
+
+    // Children to be visited. Each visited node pushes at most WIDTH - 1 more
+    // entries than it pops, at every level.
+    std::array<WideStackEntry, MAX_DEPTH * WideNode::WIDTH> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = {0, 0, ray.min_t};
+
+    alignas(32) std::array<float, WideNode::WIDTH> distances;
+
+    while (stack_size > 0) {
+        const WideStackEntry entry = stack[--stack_size];
+        // Skip boxes entered behind the closest hit found since the push.
+        if (entry.distance > closest_ray.max_t) continue;
+        if constexpr (COUNT) counters.nodes_visited++;
+
+        if (entry.count > 0) {
+            if constexpr (COUNT) counters.primitive_tests += entry.count;
+            for (uint32_t i = entry.child; i < entry.child + entry.count; i++) {
+                const Intersection primitive_hit =
+                    primitive_intersect(primitives[i], closest_ray);
+                if (primitive_hit.has_intersection()) {
+                    hit = primitive_hit;
+                    closest_ray.max_t = hit.t;
+                }
+            }
+            continue;
+        }
+
+        const WideNode& node = wide_nodes[entry.child];
+        if constexpr (COUNT) counters.box_tests += node.num_children;
+        uint32_t mask = intersect_children(node, closest_ray,
+                                           direction_negative, distances);
+
+        // Push the children hit sorted from the farthest to the nearest, so
+        // that the nearest is visited first.
+        const size_t first = stack_size;
+        while (mask != 0) {
+            const auto i = static_cast<size_t>(std::countr_zero(mask));
+            mask &= mask - 1;
 
-    const Intersection left_hit = left->intersect(ray);
-    const Intersection right_hit = right->intersect(ray);
+            const WideStackEntry child = {node.child[i], node.count[i],
+                                          distances[i]};
+            size_t j = stack_size++;
+            while (j > first && stack[j - 1].distance < child.distance) {
+                stack[j] = stack[j - 1];
+                j--;
+            }
+            stack[j] = child;
+        }
+    }
+
+    return hit;
+}
+
+template <bool COUNT>
+bool AABBTree::occluded_wide(const Ray& ray,
+                             TraversalCounters& counters) const {
+    const std::array<bool, 3> direction_negative = direction_signs(ray);
+
+    // Children to be visited, in any order since any hit ends the traversal.
+    std::array<WideStackEntry, MAX_DEPTH * WideNode::WIDTH> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = {0, 0, ray.min_t};
+
+    alignas(32) std::array<float, WideNode::WIDTH> distances;
+
+    while (stack_size > 0) {
+        const WideStackEntry entry = stack[--stack_size];
+        if constexpr (COUNT) counters.nodes_visited++;
+
+        if (entry.count > 0) {
+            for (uint32_t i = entry.child; i < entry.child + entry.count; i++) {
+                if constexpr (COUNT) counters.primitive_tests++;
+                if (primitive_occluded(primitives[i], ray)) return true;
+            }
+            continue;
+        }
+
+        const WideNode& node = wide_nodes[entry.child];
+        if constexpr (COUNT) counters.box_tests += node.num_children;
+        uint32_t mask =
+            intersect_children(node, ray, direction_negative, distances);
+        while (mask != 0) {
+            const auto i = static_cast<size_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+            stack[stack_size++] = {node.child[i], node.count[i], 0.F};
+        }
+    }
 
-    return left_hit.earlier(right_hit);
+    return false;
 }
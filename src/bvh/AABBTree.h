@@ -2,28 +2,316 @@
 #define AABBTREE_H
 
 #include <Eigen/Core>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include "../geometry/Geometry.h"
+#include "../geometry/Sphere.h"
+#include "../geometry/TriangleMesh.h"
+#include "BVHOptions.h"
+#include "BVHStats.h"
+#include "TrianglePacket.h"
+#include "WideNode.h"
 
 class AABBTree : public Geometry {
    public:
     /**
-     * Constructs an axis-aligned bounding box (AABB) tree from a list of
-     * objects. The tree is built by recursively splitting the objects based on
-     * the midpoint along the longest axis of their bounding box.
+     * Constructs an axis-aligned bounding box (AABB) tree over the primitives
+     * of a list of objects. The tree is built by recursively splitting the
+     * primitives with the builder selected in `options`, until the builder
+     * decides that a leaf is cheaper than any split. The tree is stored as a
+     * flat array of nodes. Unless `options.simd` is SimdLevel::Scalar, the
+     * triangles of each leaf are then packed to be intersected at once, and
+     * the binary tree is collapsed into a wide tree as wide as the SIMD
+     * registers, which is traversed instead.
      *
-     * @param objects A vector of shared pointers to the objects to be included
+     * If `options.cache_file` is set, the tree is read from it when it was
+     * built from the same primitives with the same options, and written to
+     * it otherwise. Trees over generic objects are not cached.
+     *
+     * The objects must have at least one primitive in total, otherwise
+     * std::invalid_argument is thrown. `build_bvh()` handles empty scenes.
+     *
+     * @param objects A vector of unique pointers to the objects to be included
      * in the AABB tree.
-     * @param depth The depth of the current node in the tree (default is 0
-     * for the root node).
+     * @param options Options controlling the builder.
      */
-    explicit AABBTree(std::vector<std::unique_ptr<Geometry>> objects);
+    AABBTree(std::vector<std::unique_ptr<Geometry>> objects,
+             const BVHOptions& options);
 
     [[nodiscard]] Intersection intersect(const Ray& ray) const override;
 
-    std::unique_ptr<Geometry> left;
-    std::unique_ptr<Geometry> right;
+    [[nodiscard]] bool occluded(const Ray& ray) const override;
+
+    [[nodiscard]] std::vector<const Object*> emitters() const override;
+
+    /**
+     * Get the traversal counters of each thread, or an empty vector if
+     * `options.collect_stats` was not set.
+     */
+    [[nodiscard]] std::vector<ThreadTraversalCounters> traversal_counters()
+        const;
+
+    /**
+     * A node of the flattened tree. Nodes are stored in depth-first order, so
+     * the left child of an inner node is the node right after it.
+     */
+    struct Node {
+        AABB bounding_box;
+        // Index of the right child for an inner node, or index of the first
+        // primitive for a leaf node.
+        uint32_t offset = 0;
+        // Number of primitives (including packets) in a leaf node (0 for an
+        // inner node).
+        uint16_t count = 0;
+        // Split axis of an inner node.
+        uint8_t axis = 0;
+    };
+    static_assert(sizeof(Node) == 32);
+
+    enum class PrimitiveType : uint8_t {
+        Generic,
+        Triangle,
+        Sphere,
+        // Triangles packed in `packets`.
+        TrianglePacket,
+    };
+
+    /**
+     * A reference to a primitive of an object. Objects are referenced through
+     * the arrays of their type, so that the primitive can be intersected
+     * without a virtual call.
+     */
+    struct Primitive {
+        static constexpr unsigned int TYPE_SHIFT = 30;
+        static constexpr uint32_t OBJECT_MASK = (1U << TYPE_SHIFT) - 1;
+
+        Primitive() = default;
+        Primitive(const PrimitiveType type, const uint32_t object,
+                  const uint32_t index)
+            : tagged_object((static_cast<uint32_t>(type) << TYPE_SHIFT) |
+                            object),
+              index(index) {}
+
+        [[nodiscard]] PrimitiveType type() const {
+            return static_cast<PrimitiveType>(tagged_object >> TYPE_SHIFT);
+        }
+
+        [[nodiscard]] uint32_t object() const {
+            return tagged_object & OBJECT_MASK;
+        }
+
+        // Type of the object in the high bits, and index of the object in the
+        // array of its type (or of the packet) in the low bits.
+        uint32_t tagged_object = 0;
+        // Index of the primitive within the object (unused for packets).
+        uint32_t index = 0;
+    };
+
+    /**
+     * A primitive with its bounding box, used while building the tree.
+     */
+    struct BuildPrimitive {
+        AABB bounding_box;
+        Primitive primitive;
+    };
+
+    // Nodes of the binary tree in depth-first order. The first node is the
+    // root.
+    std::vector<Node> nodes;
+    // Nodes of the wide tree in depth-first order, or empty if the binary
+    // tree is traversed. The first node is the root.
+    std::vector<WideNode> wide_nodes;
+    // Primitives, ordered so that each leaf references a contiguous range.
+    std::vector<Primitive> primitives;
+    // Objects owning the primitives.
+    std::vector<std::unique_ptr<Geometry>> objects;
+    // Objects by type, referenced by the primitives.
+    std::vector<const TriangleMesh*> meshes;
+    std::vector<const Sphere*> spheres;
+    std::vector<const Geometry*> generic_objects;
+    // Packed triangles of the leaves.
+    std::vector<TrianglePacket> packets;
+
+   private:
+    // Kernels intersecting the packets and the children of wide nodes,
+    // selected for the CPU.
+    PacketIntersector intersect_packet = nullptr;
+    ChildrenIntersector intersect_children = nullptr;
+
+    // Traversal counters of each OpenMP thread, or empty if they are not
+    // collected.
+    mutable std::vector<ThreadTraversalCounters> thread_counters;
+
+    // The traversals add their work to the counters if COUNT is true, and
+    // leave them untouched otherwise.
+    template <bool COUNT>
+    [[nodiscard]] Intersection intersect_binary(
+        const Ray& ray, TraversalCounters& counters) const;
+    template <bool COUNT>
+    [[nodiscard]] bool occluded_binary(const Ray& ray,
+                                       TraversalCounters& counters) const;
+    template <bool COUNT>
+    [[nodiscard]] Intersection intersect_wide(
+        const Ray& ray, TraversalCounters& counters) const;
+    template <bool COUNT>
+    [[nodiscard]] bool occluded_wide(const Ray& ray,
+                                     TraversalCounters& counters) const;
+
+    /**
+     * Get the traversal counters of the calling thread.
+     */
+    [[nodiscard]] ThreadTraversalCounters& this_thread_counters() const;
+
+    /**
+     * Intersect a primitive with ray, dispatching on its type.
+     */
+    [[nodiscard]] Intersection primitive_intersect(const Primitive& primitive,
+                                                   const Ray& ray) const;
+
+    /**
+     * Check whether the ray hits a primitive, dispatching on its type.
+     */
+    [[nodiscard]] bool primitive_occluded(const Primitive& primitive,
+                                          const Ray& ray) const;
+
+    /**
+     * Get the object owning a primitive.
+     */
+    [[nodiscard]] const Geometry& geometry_of(const Primitive& primitive) const;
+
+    /**
+     * Build the tree over the primitives of the objects.
+     *
+     * @param object_refs Reference to each object in the array of its type,
+     * with primitive index 0.
+     */
+    void build_tree(const std::vector<Primitive>& object_refs,
+                    const BVHOptions& options);
+
+    /**
+     * Hash the primitives of the objects and the options the tree depends on.
+     *
+     * @return The hash, or std::nullopt if the tree is not cached.
+     */
+    [[nodiscard]] std::optional<uint64_t> cache_key(
+        const std::vector<Primitive>& object_refs,
+        const BVHOptions& options) const;
+
+    /**
+     * Read the tree from a cache file written with the same key.
+     *
+     * @return Whether the tree was read.
+     */
+    bool read_tree(const std::filesystem::path& path, uint64_t key);
+
+    void write_tree(const std::filesystem::path& path, uint64_t key) const;
+
+    using PrimitiveIter = std::vector<BuildPrimitive>::iterator;
+
+    /**
+     * Nodes being built by concurrent tasks, where the two children of a node
+     * are allocated together. The nodes are stored in fixed-size blocks
+     * allocated on first use, so that memory is only taken by the nodes used
+     * rather than by the 2n - 1 nodes a tree over n primitives may need.
+     */
+    class BuildNodes {
+       public:
+        /**
+         * @param max_nodes Maximum number of nodes that can be allocated.
+         */
+        explicit BuildNodes(size_t max_nodes);
+
+        BuildNodes(const BuildNodes&) = delete;
+        BuildNodes(BuildNodes&&) = delete;
+        BuildNodes& operator=(const BuildNodes&) = delete;
+        BuildNodes& operator=(BuildNodes&&) = delete;
+        ~BuildNodes();
+
+        /**
+         * Allocate consecutive nodes. Safe to call from several threads.
+         *
+         * @param count Number of nodes.
+         * @return Index of the first node.
+         */
+        uint32_t allocate(uint32_t count);
+
+        [[nodiscard]] Node& operator[](const uint32_t index) const {
+            return blocks[index >> BLOCK_BITS].load(
+                std::memory_order_acquire)[index & BLOCK_MASK];
+        }
+
+        /**
+         * Get the number of nodes allocated.
+         */
+        [[nodiscard]] uint32_t size() const {
+            return num_nodes.load(std::memory_order_relaxed);
+        }
+
+       private:
+        static constexpr uint32_t BLOCK_BITS = 16;
+        static constexpr uint32_t BLOCK_SIZE = 1U << BLOCK_BITS;
+        static constexpr uint32_t BLOCK_MASK = BLOCK_SIZE - 1;
+
+        std::vector<std::atomic<Node*>> blocks;
+        std::atomic<uint32_t> num_nodes = 0;
+    };
+
+    /**
+     * State shared by the recursive calls of `build`.
+     */
+    struct BuildContext {
+        // Nodes being built. The children of an inner node are the two nodes
+        // starting at its offset.
+        BuildNodes& build_nodes;
+        // First primitive being built, used to compute the offsets of the
+        // leaves.
+        PrimitiveIter first;
+        // Morton codes of the primitives in the same order, for the LBVH
+        // builder.
+        const std::vector<uint64_t>& morton_codes;
+        const BVHOptions& options;
+    };
+
+    /**
+     * Recursively build the subtree over the primitives in [begin, end). Large
+     * subtrees are built in OpenMP tasks, so this must be called from a
+     * parallel region to use several threads.
+     *
+     * @param index Index of the root node of the subtree.
+     */
+    void build(const BuildContext& context, PrimitiveIter begin,
+               PrimitiveIter end, uint32_t index, unsigned int depth);
+
+    /**
+     * Recursively append the subtree rooted at a node of `build_nodes` to
+     * `nodes`, in depth-first order.
+     *
+     * @return Index of the root node of the subtree in `nodes`.
+     */
+    uint32_t compact(const BuildNodes& build_nodes, uint32_t index);
+
+    /**
+     * Replace the triangles of each leaf by packets of up to
+     * TrianglePacket::WIDTH triangles, placed before the other primitives of
+     * the leaf.
+     */
+    void pack_triangles();
+
+    /**
+     * Recursively collapse the binary subtree rooted at a node into wide
+     * nodes. The inner child with the largest surface area is repeatedly
+     * replaced by its children, until the wide node is full.
+     *
+     * @param index Index of the binary node.
+     * @param width Maximum number of children of a wide node.
+     * @return Index of the wide node.
+     */
+    uint32_t collapse(uint32_t index, unsigned int width);
 };
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef BVH_OPTIONS_H
+#define BVH_OPTIONS_H
+
+#include <filesystem>
+
+#include "../util/simd.h"
+
+enum class BVHBuilder {
+    // Binned surface area heuristic. Slower to build, faster to traverse.
+    SAH,
+    // Spatial midpoint of the longest axis. Fast to build.
+    Midpoint,
+    // Linear BVH over primitives sorted by Morton code. Fastest to build,
+    // for quick previews.
+    LBVH,
+};
+
+struct BVHOptions {
+    // Algorithm used to split the nodes.
+    BVHBuilder builder = BVHBuilder::SAH;
+    // Number of bins per axis evaluated by the SAH builder (at most 64).
+    unsigned int sah_bins = 16;
+    // Estimated cost of traversing an inner node.
+    float traversal_cost = 1.F;
+    // Estimated cost of intersecting a primitive, or a packet of triangles.
+    float intersection_cost = 1.F;
+    // Maximum number of primitives stored in a leaf node.
+    unsigned int max_leaf_size = 8;
+    // Instruction set used to intersect the triangles of a leaf at once.
+    SimdLevel simd = supported_simd_level();
+    // File caching the built tree, or empty to always build it. The tree is
+    // read from it when it was built from the same primitives with the same
+    // options.
+    std::filesystem::path cache_file;
+    // Whether the work done by the traversals is counted, which slows them
+    // down.
+    bool collect_stats = false;
+};
+
+#endif
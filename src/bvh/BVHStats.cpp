@@ -0,0 +1,177 @@
+#include "BVHStats.h"
+
+#include <fstream>
+#include <iostream>
+#include <json.hpp>
+
+#include "AABBTree.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+/**
+ * Sums gathered by walking the binary tree.
+ */
+struct TreeSums {
+    // Surface areas of the inner nodes.
+    float inner_area = 0.F;
+    // Surface areas of the leaves, weighted by their number of primitives.
+    float leaf_area = 0.F;
+    size_t leaf_primitives = 0;
+};
+
+static void walk(const AABBTree& tree, const uint32_t index,
+                 const size_t depth, BVHStats& stats, TreeSums& sums) {
+    const AABBTree::Node& node = tree.nodes[index];
+    const float area = node.bounding_box.surface_area();
+
+    if (node.count == 0) {
+        sums.inner_area += area;
+        walk(tree, index + 1, depth + 1, stats, sums);
+        walk(tree, node.offset, depth + 1, stats, sums);
+        return;
+    }
+
+    stats.num_leaves++;
+    if (stats.depth_histogram.size() <= depth) {
+        stats.depth_histogram.resize(depth + 1);
+    }
+    stats.depth_histogram[depth]++;
+    sums.leaf_area += area * static_cast<float>(node.count);
+    sums.leaf_primitives += node.count;
+}
+
+static TraversalCounters sum_counters(
+    const std::vector<ThreadTraversalCounters>& threads,
+    TraversalCounters ThreadTraversalCounters::* kind) {
+    TraversalCounters total;
+    for (const ThreadTraversalCounters& thread : threads) {
+        total += thread.*kind;
+    }
+    return total;
+}
+
+static float per_ray(const uint64_t count, const uint64_t rays) {
+    if (rays == 0) return 0.F;
+    return static_cast<float>(count) / static_cast<float>(rays);
+}
+
+static json counters_to_json(const TraversalCounters& counters) {
+    return {
+        {"rays", counters.rays},
+        {"nodes_visited", counters.nodes_visited},
+        {"box_tests", counters.box_tests},
+        {"primitive_tests", counters.primitive_tests},
+        {"nodes_visited_per_ray",
+         per_ray(counters.nodes_visited, counters.rays)},
+        {"box_tests_per_ray", per_ray(counters.box_tests, counters.rays)},
+        {"primitive_tests_per_ray",
+         per_ray(counters.primitive_tests, counters.rays)},
+    };
+}
+
+static void print_counters(const char* const name,
+                           const TraversalCounters& counters) {
+    std::cout << "  " << name << " rays: " << counters.rays
+              << ", per ray: nodes "
+              << per_ray(counters.nodes_visited, counters.rays) << ", boxes "
+              << per_ray(counters.box_tests, counters.rays) << ", primitives "
+              << per_ray(counters.primitive_tests, counters.rays) << "\n";
+}
+
+}  // namespace
+
+TraversalCounters& TraversalCounters::operator+=(
+    const TraversalCounters& other) {
+    rays += other.rays;
+    nodes_visited += other.nodes_visited;
+    box_tests += other.box_tests;
+    primitive_tests += other.primitive_tests;
+    return *this;
+}
+
+BVHStats compute_bvh_stats(const AABBTree& tree, const BVHOptions& options,
+                           const float build_time) {
+    BVHStats stats;
+    stats.num_nodes = tree.nodes.size();
+    stats.num_wide_nodes = tree.wide_nodes.size();
+    stats.build_time = build_time;
+    stats.threads = tree.traversal_counters();
+
+    TreeSums sums;
+    walk(tree, 0, 0, stats, sums);
+    stats.average_leaf_size = static_cast<float>(sums.leaf_primitives) /
+                              static_cast<float>(stats.num_leaves);
+
+    // Expected cost of a random ray hitting the root, where the probability
+    // of hitting a node is proportional to its surface area.
+    const float root_area = tree.nodes[0].bounding_box.surface_area();
+    if (root_area > 0.F) {
+        stats.sah_cost = (options.traversal_cost * sums.inner_area +
+                          options.intersection_cost * sums.leaf_area) /
+                         root_area;
+    }
+    return stats;
+}
+
+void print_bvh_stats(const BVHStats& stats) {
+    std::cout << "BVH statistics:\n";
+    std::cout << "  Nodes: " << stats.num_nodes
+              << " (leaves: " << stats.num_leaves
+              << ", wide nodes: " << stats.num_wide_nodes << ")\n";
+    std::cout << "  Average leaf size: " << stats.average_leaf_size << "\n";
+    std::cout << "  SAH cost: " << stats.sah_cost << "\n";
+    std::cout << "  Build time: " << stats.build_time << " ms\n";
+    std::cout << "  Leaves by depth:";
+    for (size_t depth = 0; depth < stats.depth_histogram.size(); depth++) {
+        if (stats.depth_histogram[depth] == 0) continue;
+        std::cout << " " << depth << ":" << stats.depth_histogram[depth];
+    }
+    std::cout << "\n";
+
+    if (stats.threads.empty()) return;
+    print_counters("Closest-hit",
+                   sum_counters(stats.threads,
+                                &ThreadTraversalCounters::closest_hit));
+    print_counters("Any-hit",
+                   sum_counters(stats.threads,
+                                &ThreadTraversalCounters::any_hit));
+}
+
+void write_bvh_stats(const BVHStats& stats,
+                     const std::filesystem::path& filename) {
+    json j_threads = json::array();
+    for (const ThreadTraversalCounters& thread : stats.threads) {
+        j_threads.push_back({
+            {"closest_hit", counters_to_json(thread.closest_hit)},
+            {"any_hit", counters_to_json(thread.any_hit)},
+        });
+    }
+
+    const json j = {
+        {"nodes", stats.num_nodes},
+        {"leaves", stats.num_leaves},
+        {"wide_nodes", stats.num_wide_nodes},
+        {"depth_histogram", stats.depth_histogram},
+        {"average_leaf_size", stats.average_leaf_size},
+        {"sah_cost", stats.sah_cost},
+        {"build_time_ms", stats.build_time},
+        {"traversal",
+         {
+             {"closest_hit",
+              counters_to_json(sum_counters(
+                  stats.threads, &ThreadTraversalCounters::closest_hit))},
+             {"any_hit",
+              counters_to_json(sum_counters(
+                  stats.threads, &ThreadTraversalCounters::any_hit))},
+             {"threads", j_threads},
+         }},
+    };
+
+    std::ofstream file(filename);
+    file << j.dump(4) << "\n";
+    if (!file) {
+        std::cerr << "Cannot write BVH statistics: " << filename << "\n";
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef BVH_STATS_H
+#define BVH_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "BVHOptions.h"
+
+class AABBTree;
+
+/**
+ * Work done by the traversals of a BVH, summed over the rays.
+ */
+struct TraversalCounters {
+    uint64_t rays = 0;
+    // Nodes popped from the traversal stack.
+    uint64_t nodes_visited = 0;
+    // Ray-box tests, one per child of a wide node.
+    uint64_t box_tests = 0;
+    // Ray-primitive tests, where a packet of triangles counts as one.
+    uint64_t primitive_tests = 0;
+
+    TraversalCounters& operator+=(const TraversalCounters& other);
+};
+
+/**
+ * Traversal counters of a thread. Each thread owns a cache line, so that the
+ * counters are not shared between cores.
+ */
+struct alignas(64) ThreadTraversalCounters {
+    // Closest-hit traversals of `intersect()`.
+    TraversalCounters closest_hit;
+    // Any-hit traversals of `occluded()`, for shadow rays.
+    TraversalCounters any_hit;
+};
+
+/**
+ * Statistics describing the quality of a BVH, and the work done to traverse
+ * it.
+ */
+struct BVHStats {
+    // Nodes of the binary tree.
+    size_t num_nodes = 0;
+    size_t num_leaves = 0;
+    // Nodes of the wide tree (0 if the binary tree is traversed).
+    size_t num_wide_nodes = 0;
+    // Number of leaves at each depth.
+    std::vector<size_t> depth_histogram;
+    // Mean number of primitives (including packets) per leaf.
+    float average_leaf_size = 0.F;
+    // Expected cost of a ray traversal under the surface area heuristic,
+    // relative to the root.
+    float sah_cost = 0.F;
+    // Time taken to build (or read) the tree, in milliseconds.
+    float build_time = 0.F;
+    // Traversal counters of each thread, if they are collected.
+    std::vector<ThreadTraversalCounters> threads;
+};
+
+/**
+ * Compute the statistics of the structure of a BVH, and collect its
+ * traversal counters.
+ *
+ * @param tree The BVH.
+ * @param options Options the BVH was built with, for the SAH costs.
+ * @param build_time Time taken to build the BVH, in milliseconds.
+ * @return The statistics.
+ */
+BVHStats compute_bvh_stats(const AABBTree& tree, const BVHOptions& options,
+                           float build_time);
+
+/**
+ * Print the statistics in a human-readable form.
+ */
+void print_bvh_stats(const BVHStats& stats);
+
+/**
+ * Write the statistics to a JSON file.
+ */
+void write_bvh_stats(const BVHStats& stats,
+                     const std::filesystem::path& filename);
+
+#endif
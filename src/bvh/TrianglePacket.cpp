@@ -0,0 +1,250 @@
+#include "TrianglePacket.h"
+
+#include <bit>
+#include <limits>
+
+#ifdef SIMD_X86_64
+#include <immintrin.h>
+#endif
+
+void TrianglePacket::set(const unsigned int lane, const uint32_t mesh,
+                         const uint32_t triangle,
+                         const std::array<Eigen::Vector3f, 3>& vertices) {
+    const Eigen::Vector3f edge1 = vertices[1] - vertices[0];
+    const Eigen::Vector3f edge2 = vertices[2] - vertices[0];
+    for (int axis = 0; axis < 3; axis++) {
+        v0[axis][lane] = vertices[0](axis);
+        e1[axis][lane] = edge1(axis);
+        e2[axis][lane] = edge2(axis);
+    }
+    object[lane] = mesh;
+    primitive[lane] = triangle;
+}
+
+#ifdef SIMD_X86_64
+
+namespace {
+
+// Same tolerance as TriangleMesh::intersect_primitive.
+static const float EPSILON = 1e-6F;
+
+/**
+ * Intersect a ray with the triangles in lanes [base, base + 4) of a packet.
+ *
+ * @return Bit mask of the lanes hit, with their distances in `t`, `u` and `v`.
+ */
+static int intersect_sse_half(const TrianglePacket& packet,
+                              const unsigned int base, const Ray& ray,
+                              const float max_t, __m128& t, __m128& u,
+                              __m128& v) {
+    const __m128 dx = _mm_set1_ps(ray.direction.x());
+    const __m128 dy = _mm_set1_ps(ray.direction.y());
+    const __m128 dz = _mm_set1_ps(ray.direction.z());
+
+    const __m128 e1x = _mm_load_ps(&packet.e1[0][base]);
+    const __m128 e1y = _mm_load_ps(&packet.e1[1][base]);
+    const __m128 e1z = _mm_load_ps(&packet.e1[2][base]);
+    const __m128 e2x = _mm_load_ps(&packet.e2[0][base]);
+    const __m128 e2y = _mm_load_ps(&packet.e2[1][base]);
+    const __m128 e2z = _mm_load_ps(&packet.e2[2][base]);
+
+    // h = direction × e2
+    const __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    const __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    const __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    const __m128 det = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)),
+        _mm_mul_ps(e1z, hz));
+    const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.F), det);
+
+    // s = origin - v0
+    const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x()),
+                                 _mm_load_ps(&packet.v0[0][base]));
+    const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y()),
+                                 _mm_load_ps(&packet.v0[1][base]));
+    const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z()),
+                                 _mm_load_ps(&packet.v0[2][base]));
+
+    u = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx),
+                                                  _mm_mul_ps(sy, hy)),
+                                       _mm_mul_ps(sz, hz)));
+
+    // q = s × e1
+    const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+    v = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+                                                  _mm_mul_ps(dy, qy)),
+                                       _mm_mul_ps(dz, qz)));
+    t = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx),
+                                                  _mm_mul_ps(e2y, qy)),
+                                       _mm_mul_ps(e2z, qz)));
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.F);
+    const __m128 abs_det = _mm_andnot_ps(_mm_set1_ps(-0.F), det);
+    __m128 mask = _mm_cmpge_ps(abs_det, _mm_set1_ps(EPSILON));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(u, one));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(t, _mm_set1_ps(ray.min_t)));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(t, _mm_set1_ps(max_t)));
+
+    // Move the missed lanes to infinity, so that they lose the minimum.
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    t = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, inf));
+    return _mm_movemask_ps(mask);
+}
+
+static PacketHit intersect_sse(const TrianglePacket& packet, const Ray& ray) {
+    PacketHit hit;
+    float max_t = ray.max_t;
+
+    // The second half is skipped if it only holds unused lanes.
+    for (unsigned int base = 0; base < TrianglePacket::WIDTH &&
+                                packet.object[base] != TrianglePacket::EMPTY;
+         base += 4) {
+        __m128 t;
+        __m128 u;
+        __m128 v;
+        const int lanes =
+            intersect_sse_half(packet, base, ray, max_t, t, u, v);
+        if (lanes == 0) continue;
+
+        __m128 min_t =
+            _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+        min_t = _mm_min_ps(
+            min_t, _mm_shuffle_ps(min_t, min_t, _MM_SHUFFLE(1, 0, 3, 2)));
+        const int closest = std::countr_zero(static_cast<unsigned int>(
+            _mm_movemask_ps(_mm_cmpeq_ps(t, min_t)) & lanes));
+
+        alignas(16) std::array<float, 4> ts;
+        alignas(16) std::array<float, 4> us;
+        alignas(16) std::array<float, 4> vs;
+        _mm_store_ps(ts.data(), t);
+        _mm_store_ps(us.data(), u);
+        _mm_store_ps(vs.data(), v);
+
+        hit = {static_cast<int>(base) + closest, ts[closest], us[closest],
+               vs[closest]};
+        max_t = hit.t;
+    }
+
+    return hit;
+}
+
+SIMD_TARGET_AVX2 static PacketHit intersect_avx2(const TrianglePacket& packet,
+                                                 const Ray& ray) {
+    const __m256 dx = _mm256_set1_ps(ray.direction.x());
+    const __m256 dy = _mm256_set1_ps(ray.direction.y());
+    const __m256 dz = _mm256_set1_ps(ray.direction.z());
+
+    const __m256 e1x = _mm256_load_ps(packet.e1[0].data());
+    const __m256 e1y = _mm256_load_ps(packet.e1[1].data());
+    const __m256 e1z = _mm256_load_ps(packet.e1[2].data());
+    const __m256 e2x = _mm256_load_ps(packet.e2[0].data());
+    const __m256 e2y = _mm256_load_ps(packet.e2[1].data());
+    const __m256 e2z = _mm256_load_ps(packet.e2[2].data());
+
+    // h = direction × e2
+    const __m256 hx =
+        _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    const __m256 hy =
+        _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    const __m256 hz =
+        _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+
+    const __m256 det = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)),
+        _mm256_mul_ps(e1z, hz));
+    const __m256 inv_det = _mm256_div_ps(_mm256_set1_ps(1.F), det);
+
+    // s = origin - v0
+    const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.origin.x()),
+                                    _mm256_load_ps(packet.v0[0].data()));
+    const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.origin.y()),
+                                    _mm256_load_ps(packet.v0[1].data()));
+    const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.origin.z()),
+                                    _mm256_load_ps(packet.v0[2].data()));
+
+    const __m256 u = _mm256_mul_ps(
+        inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx),
+                                             _mm256_mul_ps(sy, hy)),
+                               _mm256_mul_ps(sz, hz)));
+
+    // q = s × e1
+    const __m256 qx =
+        _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    const __m256 qy =
+        _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    const __m256 qz =
+        _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+
+    const __m256 v = _mm256_mul_ps(
+        inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx),
+                                             _mm256_mul_ps(dy, qy)),
+                               _mm256_mul_ps(dz, qz)));
+    __m256 t = _mm256_mul_ps(
+        inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx),
+                                             _mm256_mul_ps(e2y, qy)),
+                               _mm256_mul_ps(e2z, qz)));
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.F);
+    const __m256 abs_det = _mm256_andnot_ps(_mm256_set1_ps(-0.F), det);
+    __m256 mask = _mm256_cmp_ps(abs_det, _mm256_set1_ps(EPSILON), _CMP_GE_OQ);
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask,
+                         _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+    mask = _mm256_and_ps(
+        mask, _mm256_cmp_ps(t, _mm256_set1_ps(ray.min_t), _CMP_GE_OQ));
+    mask = _mm256_and_ps(
+        mask, _mm256_cmp_ps(t, _mm256_set1_ps(ray.max_t), _CMP_LE_OQ));
+
+    const int lanes = _mm256_movemask_ps(mask);
+    if (lanes == 0) return {};
+
+    // Move the missed lanes to infinity, so that they lose the minimum.
+    t = _mm256_blendv_ps(
+        _mm256_set1_ps(std::numeric_limits<float>::infinity()), t, mask);
+    __m256 min_t = _mm256_min_ps(t, _mm256_permute2f128_ps(t, t, 1));
+    min_t = _mm256_min_ps(
+        min_t, _mm256_permute_ps(min_t, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_t = _mm256_min_ps(
+        min_t, _mm256_permute_ps(min_t, _MM_SHUFFLE(2, 3, 0, 1)));
+    const int closest = std::countr_zero(static_cast<unsigned int>(
+        _mm256_movemask_ps(_mm256_cmp_ps(t, min_t, _CMP_EQ_OQ)) & lanes));
+
+    alignas(32) std::array<float, TrianglePacket::WIDTH> ts;
+    alignas(32) std::array<float, TrianglePacket::WIDTH> us;
+    alignas(32) std::array<float, TrianglePacket::WIDTH> vs;
+    _mm256_store_ps(ts.data(), t);
+    _mm256_store_ps(us.data(), u);
+    _mm256_store_ps(vs.data(), v);
+    return {closest, ts[closest], us[closest], vs[closest]};
+}
+
+}  // namespace
+
+#endif
+
+PacketIntersector packet_intersector(const SimdLevel level) {
+#ifdef SIMD_X86_64
+    switch (level) {
+        case SimdLevel::SSE:
+            return intersect_sse;
+        case SimdLevel::AVX2:
+            return intersect_avx2;
+        default:
+            return nullptr;
+    }
+#else
+    (void)level;
+    return nullptr;
+#endif
+}
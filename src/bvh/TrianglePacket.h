@@ -0,0 +1,73 @@
+#ifndef TRIANGLE_PACKET_H
+#define TRIANGLE_PACKET_H
+
+#include <Eigen/Core>
+#include <array>
+#include <cstdint>
+
+#include "../Ray.h"
+#include "../util/simd.h"
+
+/**
+ * Up to WIDTH triangles stored in structure-of-arrays form, so that a ray can
+ * be intersected with all of them at once using SIMD instructions. Unused
+ * lanes hold degenerate triangles, which are never hit.
+ */
+struct alignas(32) TrianglePacket {
+    static constexpr unsigned int WIDTH = 8;
+    // Mesh index of an unused lane.
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    TrianglePacket() { object.fill(EMPTY); }
+
+    /**
+     * Store a triangle in a lane.
+     *
+     * @param lane Index of the lane.
+     * @param mesh Index of the mesh of the triangle.
+     * @param triangle Index of the triangle within the mesh.
+     * @param vertices Positions of the vertices of the triangle.
+     */
+    void set(unsigned int lane, uint32_t mesh, uint32_t triangle,
+             const std::array<Eigen::Vector3f, 3>& vertices);
+
+    // First vertex, and the edges from it to the second and third vertices,
+    // indexed by axis and then by lane.
+    std::array<std::array<float, WIDTH>, 3> v0{};
+    std::array<std::array<float, WIDTH>, 3> e1{};
+    std::array<std::array<float, WIDTH>, 3> e2{};
+    // Index of the mesh of each triangle, or EMPTY for an unused lane.
+    std::array<uint32_t, WIDTH> object{};
+    // Index of each triangle within its mesh.
+    std::array<uint32_t, WIDTH> primitive{};
+};
+
+/**
+ * The closest hit of a ray with the triangles of a packet.
+ */
+struct PacketHit {
+    // Lane of the hit triangle, or -1 if no triangle is hit.
+    int lane = -1;
+    float t = 0.F;
+    // Barycentric weights of the second and third vertices.
+    float u = 0.F;
+    float v = 0.F;
+};
+
+/**
+ * A kernel intersecting a ray with the triangles of a packet, using the
+ * Möller–Trumbore algorithm on every lane.
+ */
+using PacketIntersector = PacketHit (*)(const TrianglePacket& packet,
+                                        const Ray& ray);
+
+/**
+ * Get the packet kernel of an instruction set.
+ *
+ * @param level Instruction set, which must be supported by the CPU.
+ * @return The kernel, or nullptr for SimdLevel::Scalar, where triangles are
+ * not packed.
+ */
+PacketIntersector packet_intersector(SimdLevel level);
+
+#endif
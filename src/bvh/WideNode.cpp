@@ -0,0 +1,120 @@
+#include "WideNode.h"
+
+#include <limits>
+
+#ifdef SIMD_X86_64
+#include <immintrin.h>
+#endif
+
+WideNode::WideNode() {
+    for (int axis = 0; axis < 3; axis++) {
+        min_corner[axis].fill(std::numeric_limits<float>::infinity());
+        max_corner[axis].fill(-std::numeric_limits<float>::infinity());
+    }
+}
+
+void WideNode::set(const unsigned int slot, const AABB& bounding_box,
+                   const uint32_t child, const uint16_t count) {
+    for (int axis = 0; axis < 3; axis++) {
+        min_corner[axis][slot] = bounding_box.min_corner(axis);
+        max_corner[axis][slot] = bounding_box.max_corner(axis);
+    }
+    this->child[slot] = child;
+    this->count[slot] = count;
+}
+
+#ifdef SIMD_X86_64
+
+namespace {
+
+// The distances to the slabs are computed from the near and far planes
+// selected by the sign of the direction, so that empty boxes are never hit.
+// When the ray lies in the plane of a slab parallel to it, the distance is
+// NaN, and that slab is ignored by passing it first to min/max.
+
+static uint32_t intersect_children_sse(
+    const WideNode& node, const Ray& ray,
+    const std::array<bool, 3>& direction_negative,
+    std::array<float, WideNode::WIDTH>& distances) {
+    uint32_t mask = 0;
+
+    // The second half is skipped if it only holds unused children.
+    for (unsigned int base = 0; base < node.num_children; base += 4) {
+        __m128 near = _mm_set1_ps(ray.min_t);
+        __m128 far = _mm_set1_ps(ray.max_t);
+        for (int axis = 0; axis < 3; axis++) {
+            const auto& near_plane = direction_negative[axis]
+                                         ? node.max_corner[axis]
+                                         : node.min_corner[axis];
+            const auto& far_plane = direction_negative[axis]
+                                        ? node.min_corner[axis]
+                                        : node.max_corner[axis];
+            const __m128 origin = _mm_set1_ps(ray.origin(axis));
+            const __m128 inv_direction = _mm_set1_ps(ray.inv_direction(axis));
+            near = _mm_max_ps(
+                _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&near_plane[base]), origin),
+                           inv_direction),
+                near);
+            far = _mm_min_ps(
+                _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&far_plane[base]), origin),
+                           inv_direction),
+                far);
+        }
+        _mm_store_ps(&distances[base], near);
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(near, far)))
+                << base;
+    }
+
+    return mask;
+}
+
+SIMD_TARGET_AVX2 static uint32_t intersect_children_avx2(
+    const WideNode& node, const Ray& ray,
+    const std::array<bool, 3>& direction_negative,
+    std::array<float, WideNode::WIDTH>& distances) {
+    __m256 near = _mm256_set1_ps(ray.min_t);
+    __m256 far = _mm256_set1_ps(ray.max_t);
+    for (int axis = 0; axis < 3; axis++) {
+        const auto& near_plane = direction_negative[axis]
+                                     ? node.max_corner[axis]
+                                     : node.min_corner[axis];
+        const auto& far_plane = direction_negative[axis]
+                                    ? node.min_corner[axis]
+                                    : node.max_corner[axis];
+        const __m256 origin = _mm256_set1_ps(ray.origin(axis));
+        const __m256 inv_direction = _mm256_set1_ps(ray.inv_direction(axis));
+        near = _mm256_max_ps(
+            _mm256_mul_ps(
+                _mm256_sub_ps(_mm256_load_ps(near_plane.data()), origin),
+                inv_direction),
+            near);
+        far = _mm256_min_ps(
+            _mm256_mul_ps(
+                _mm256_sub_ps(_mm256_load_ps(far_plane.data()), origin),
+                inv_direction),
+            far);
+    }
+    _mm256_store_ps(distances.data(), near);
+    return static_cast<uint32_t>(
+        _mm256_movemask_ps(_mm256_cmp_ps(near, far, _CMP_LE_OQ)));
+}
+
+}  // namespace
+
+#endif
+
+ChildrenIntersector children_intersector(const SimdLevel level) {
+#ifdef SIMD_X86_64
+    switch (level) {
+        case SimdLevel::SSE:
+            return intersect_children_sse;
+        case SimdLevel::AVX2:
+            return intersect_children_avx2;
+        default:
+            return nullptr;
+    }
+#else
+    (void)level;
+    return nullptr;
+#endif
+}
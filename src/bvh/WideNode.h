@@ -0,0 +1,74 @@
+#ifndef WIDE_NODE_H
+#define WIDE_NODE_H
+
+#include <array>
+#include <cstdint>
+
+#include "../Ray.h"
+#include "../util/simd.h"
+#include "AABB.h"
+
+/**
+ * A node of a wide BVH, with up to WIDTH children. The bounding boxes of the
+ * children are stored in structure-of-arrays form, so that a ray can be
+ * tested against all of them at once using SIMD instructions. Unused children
+ * have empty boxes, which are never hit.
+ */
+struct alignas(32) WideNode {
+    static constexpr unsigned int WIDTH = 8;
+
+    WideNode();
+
+    /**
+     * Store a child.
+     *
+     * @param slot Index of the child.
+     * @param bounding_box Bounding box of the child.
+     * @param child Index of the child node for an inner child, or of the first
+     * primitive for a leaf child.
+     * @param count Number of primitives of a leaf child, or 0 for an inner
+     * child.
+     */
+    void set(unsigned int slot, const AABB& bounding_box, uint32_t child,
+             uint16_t count);
+
+    // Corners of the bounding boxes of the children, indexed by axis and then
+    // by child.
+    std::array<std::array<float, WIDTH>, 3> min_corner;
+    std::array<std::array<float, WIDTH>, 3> max_corner;
+    // Index of the child node for an inner child, or of the first primitive
+    // for a leaf child.
+    std::array<uint32_t, WIDTH> child{};
+    // Number of primitives of a leaf child (0 for an inner child).
+    std::array<uint16_t, WIDTH> count{};
+    // Number of used children, which are the first ones.
+    uint32_t num_children = 0;
+};
+static_assert(sizeof(WideNode) == 256);
+
+/**
+ * A kernel testing a ray against the bounding boxes of the children of a
+ * node with the slab method.
+ *
+ * @param node Node whose children are tested.
+ * @param ray Ray to test.
+ * @param direction_negative Whether each component of the inverse of the ray
+ * direction is negative, which selects the near and far planes of the slabs.
+ * @param distances Set to the distance at which the ray enters each box.
+ * @return Bit mask of the children hit.
+ */
+using ChildrenIntersector = uint32_t (*)(
+    const WideNode& node, const Ray& ray,
+    const std::array<bool, 3>& direction_negative,
+    std::array<float, WideNode::WIDTH>& distances);
+
+/**
+ * Get the child box kernel of an instruction set.
+ *
+ * @param level Instruction set, which must be supported by the CPU.
+ * @return The kernel, or nullptr for SimdLevel::Scalar, where the binary tree
+ * is traversed instead.
+ */
+ChildrenIntersector children_intersector(SimdLevel level);
+
+#endif
@@ -1,10 +1,19 @@
 #include "build_bvh.h"
 
+#include <vector>
+
 #include "AABBTree.h"
 
 std::unique_ptr<Geometry> build_bvh(
-    std::vector<std::unique_ptr<Geometry>> objects) {
+    std::vector<std::unique_ptr<Geometry>> objects, const BVHOptions& options) {
+    // Objects without primitives, such as empty meshes, cannot be hit.
+    std::erase_if(objects, [](const std::unique_ptr<Geometry>& object) {
+        return object->num_primitives() == 0;
+    });
+
     if (objects.empty()) return std::make_unique<Geometry>();
-    if (objects.size() == 1) return std::move(objects[0]);
-    return std::make_unique<AABBTree>(std::move(objects));
+    if (objects.size() == 1 && objects[0]->num_primitives() == 1) {
+        return std::move(objects[0]);
+    }
+    return std::make_unique<AABBTree>(std::move(objects), options);
 }
@@ -2,8 +2,16 @@
 #define BUILD_BVH_H
 
 #include "../geometry/Geometry.h"
+#include "BVHOptions.h"
 
+/**
+ * Build a bounding volume hierarchy (BVH) over the primitives of the objects.
+ *
+ * @param objects Objects to be included in the BVH.
+ * @param options Options controlling the builder.
+ * @return Root of the BVH.
+ */
 std::unique_ptr<Geometry> build_bvh(
-    std::vector<std::unique_ptr<Geometry>> objects);
+    std::vector<std::unique_ptr<Geometry>> objects, const BVHOptions& options);
 
 #endif
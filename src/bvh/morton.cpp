@@ -0,0 +1,97 @@
+#include "morton.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// Number of bits of a quantized coordinate.
+static const unsigned int AXIS_BITS = 21;
+// Number of bits of a digit of the radix sort.
+static const unsigned int DIGIT_BITS = 8;
+static const size_t NUM_DIGITS = size_t{1} << DIGIT_BITS;
+
+/**
+ * Spread the 21 lowest bits of a value so that there are two zero bits
+ * between each of them.
+ */
+static uint64_t expand_bits(uint64_t value) {
+    value &= 0x1FFFFF;
+    value = (value | value << 32) & 0x1F00000000FFFF;
+    value = (value | value << 16) & 0x1F0000FF0000FF;
+    value = (value | value << 8) & 0x100F00F00F00F00F;
+    value = (value | value << 4) & 0x10C30C30C30C30C3;
+    value = (value | value << 2) & 0x1249249249249249;
+    return value;
+}
+
+}  // namespace
+
+uint64_t morton_code(const Eigen::Vector3f& point) {
+    const auto scale = static_cast<float>(1U << AXIS_BITS);
+    const auto quantize = [scale](const float x) -> uint64_t {
+        const float clamped = std::clamp(x * scale, 0.F, scale - 1);
+        return static_cast<uint64_t>(clamped);
+    };
+    return expand_bits(quantize(point.x())) << 2 |
+           expand_bits(quantize(point.y())) << 1 |
+           expand_bits(quantize(point.z()));
+}
+
+void radix_sort(std::vector<MortonKey>& keys) {
+    const size_t count = keys.size();
+    std::vector<MortonKey> buffer(count);
+    // Digit counts of each thread, turned into the output positions.
+    std::vector<std::array<size_t, NUM_DIGITS>> positions(
+        static_cast<size_t>(omp_get_max_threads()));
+
+    for (unsigned int shift = 0; shift < MORTON_CODE_BITS;
+         shift += DIGIT_BITS) {
+        const auto digit = [shift](const MortonKey& key) {
+            return static_cast<size_t>((key.code >> shift) & (NUM_DIGITS - 1));
+        };
+        bool skip = false;
+
+#pragma omp parallel
+        {
+            const auto thread = static_cast<size_t>(omp_get_thread_num());
+            const auto num_threads = static_cast<size_t>(omp_get_num_threads());
+            const size_t begin = count * thread / num_threads;
+            const size_t end = count * (thread + 1) / num_threads;
+
+            std::array<size_t, NUM_DIGITS>& thread_positions =
+                positions[thread];
+            thread_positions.fill(0);
+            for (size_t i = begin; i < end; i++) {
+                thread_positions[digit(keys[i])]++;
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+                // Keys go to the slots of their digit in thread order, which
+                // keeps the sort stable.
+                size_t position = 0;
+                for (size_t d = 0; d < NUM_DIGITS; d++) {
+                    const size_t digit_begin = position;
+                    for (size_t t = 0; t < num_threads; t++) {
+                        const size_t digit_count = positions[t][d];
+                        positions[t][d] = position;
+                        position += digit_count;
+                    }
+                    if (position - digit_begin == count) skip = true;
+                }
+            }
+
+            if (!skip) {
+                for (size_t i = begin; i < end; i++) {
+                    buffer[thread_positions[digit(keys[i])]++] = keys[i];
+                }
+            }
+        }
+
+        if (!skip) keys.swap(buffer);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <vector>
+
+// Number of bits of a Morton code, interleaving 21 bits per axis.
+constexpr unsigned int MORTON_CODE_BITS = 63;
+
+/**
+ * Compute the Morton code of a point, which orders the points along a
+ * Z-order curve. Bit 3k + 2 - a of the code is bit k of the quantized
+ * coordinate along axis a.
+ *
+ * @param point Point in the unit cube.
+ * @return 63-bit Morton code.
+ */
+uint64_t morton_code(const Eigen::Vector3f& point);
+
+/**
+ * A key to be sorted with the index of the item it belongs to.
+ */
+struct MortonKey {
+    uint64_t code;
+    uint32_t index;
+};
+
+/**
+ * Sort keys by code with a parallel least significant digit radix sort. The
+ * sort is stable, and passes over digits shared by all the keys are skipped.
+ *
+ * @param keys Keys to sort in place.
+ */
+void radix_sort(std::vector<MortonKey>& keys);
+
+#endif
@@ -1,17 +1,34 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
+#include <cstdint>
+#include <vector>
+
 #include "../Intersection.h"
 #include "../Object.h"
+#include "../SurfaceInteraction.h"
 #include "../bvh/AABB.h"
 #include "../material/Material.h"
 
+/**
+ * Concrete type of a geometry, used to dispatch calls statically in the hot
+ * paths instead of through virtual functions.
+ */
+enum class GeometryType : uint8_t {
+    // Any other geometry, dispatched through virtual functions.
+    Generic,
+    TriangleMesh,
+    Sphere,
+};
+
 class Geometry : public Object {
    public:
     explicit Geometry(AABB bounding_box = {},
-                      std::shared_ptr<Material> material = nullptr)
+                      std::shared_ptr<Material> material = nullptr,
+                      const GeometryType type = GeometryType::Generic)
         : bounding_box(std::move(bounding_box)),
-          material(std::move(material)) {}
+          material(std::move(material)),
+          type(type) {}
 
     /**
      * Intersect object with ray.
@@ -25,44 +42,95 @@ class Geometry : public Object {
     }
 
     /**
-     * Get the geometry normal at a given point on the object's surface.
+     * Check whether the ray hits the object anywhere between its `min_t` and
+     * `max_t`. Unlike `intersect()`, the closest hit does not need to be found.
      *
-     * @param ray Incoming ray.
-     * @param point Point on the object's surface.
-     * @return Normal vector.
+     * @param ray Ray to test.
+     * @return Whether the ray is occluded by the object.
      */
-    [[nodiscard]] virtual Eigen::Vector3f normal_at(
-        [[maybe_unused]] const Ray& ray,
-        [[maybe_unused]] const Eigen::Vector3f& point) const {
-        throw std::logic_error("normal_at() not implemented for this object.");
+    [[nodiscard]] virtual bool occluded(const Ray& ray) const {
+        return intersect(ray).has_intersection();
     }
 
     /**
-     * Compute the tangent space matrix at a given point on the object's
-     * surface.
+     * Get the number of primitives the object is made of. The BVH is built
+     * over the primitives of all the objects.
+     *
+     * @return Number of primitives.
+     */
+    [[nodiscard]] virtual uint32_t num_primitives() const { return 1; }
+
+    /**
+     * Get the bounding box of a primitive of the object.
      *
-     * @param point Point on the object's surface.
-     * @param normal Normal vector at the given point.
-     * @return Tangent space matrix where columns are tangent, bitangent,
-     *         and normal vectors.
+     * @param primitive Index of the primitive.
+     * @return Bounding box of the primitive.
      */
-    [[nodiscard]] virtual Eigen::Matrix3f tangent_space_at(
-        [[maybe_unused]] const Eigen::Vector3f& point,
-        [[maybe_unused]] const Eigen::Vector3f& normal) const {
-        throw std::logic_error(
-            "tangent_space_at() not implemented for this object.");
+    [[nodiscard]] virtual AABB primitive_bounding_box(
+        [[maybe_unused]] const uint32_t primitive) const {
+        return bounding_box;
     }
 
     /**
-     * Get texture coordinates at a given point on the object's surface.
+     * Intersect a single primitive of the object with ray.
      *
-     * @param point Point on the object's surface.
-     * @return Texture coordinates at the given point.
+     * @param ray Ray to intersect with.
+     * @param primitive Index of the primitive.
+     * @return Intersection information.
+     */
+    [[nodiscard]] virtual Intersection intersect_primitive(
+        const Ray& ray, [[maybe_unused]] const uint32_t primitive) const {
+        return intersect(ray);
+    }
+
+    /**
+     * Check whether the ray hits a single primitive of the object anywhere
+     * between its `min_t` and `max_t`.
+     *
+     * @param ray Ray to test.
+     * @param primitive Index of the primitive.
+     * @return Whether the ray is occluded by the primitive.
      */
-    [[nodiscard]] virtual Eigen::Vector2f texcoords_at(
-        [[maybe_unused]] const Eigen::Vector3f& point) const {
-        throw std::logic_error(
-            "texcoords_at() not implemented for this object.");
+    [[nodiscard]] virtual bool occluded_primitive(
+        const Ray& ray, const uint32_t primitive) const {
+        return intersect_primitive(ray, primitive).has_intersection();
+    }
+
+    /**
+     * Get the parts of the object to be sampled as light sources.
+     *
+     * @return Objects sampled as light sources, empty if the object does not
+     * emit light.
+     */
+    [[nodiscard]] virtual std::vector<const Object*> emitters() const {
+        if (material && material->emissive) return {this};
+        return {};
+    }
+
+    /**
+     * Get the object sampled as a light source for a hit on the object.
+     *
+     * @param intersection Intersection with the object.
+     * @return One of `emitters()`, or nullptr if the hit primitive is not
+     * sampled as a light source.
+     */
+    [[nodiscard]] virtual const Object* emitter_at(
+        [[maybe_unused]] const Intersection& intersection) const {
+        if (material && material->emissive) return this;
+        return nullptr;
+    }
+
+    /**
+     * Compute the shading information at a hit on the object's surface.
+     *
+     * @param ray Incoming ray.
+     * @param intersection Intersection of the ray with the object.
+     * @return Shading information at the hit.
+     */
+    [[nodiscard]] virtual SurfaceInteraction surface_at(
+        [[maybe_unused]] const Ray& ray,
+        [[maybe_unused]] const Intersection& intersection) const {
+        throw std::logic_error("surface_at() not implemented for this object.");
     }
 
     [[nodiscard]] Eigen::Vector3f emission_at(
@@ -72,6 +140,7 @@ class Geometry : public Object {
 
     AABB bounding_box;
     std::shared_ptr<Material> material;
+    GeometryType type;
 };
 
 #endif
@@ -0,0 +1,94 @@
+#include "Instance.h"
+
+#include <array>
+
+#include "visit_geometry.h"
+
+Instance::Instance(std::shared_ptr<const Geometry> object,
+                   const Eigen::Affine3f& transform)
+    : object(std::move(object)),
+      to_world(transform),
+      to_object(transform.inverse()),
+      normal_to_world(transform.linear().inverse().transpose()) {
+    // Bound the transformed corners of the bounding box of the object.
+    const AABB& box = this->object->bounding_box;
+    if ((box.dimensions().array() >= 0).all()) {
+        for (unsigned int i = 0; i < 8; i++) {
+            const Eigen::Vector3f corner(
+                (i & 1U) != 0 ? box.max_corner.x() : box.min_corner.x(),
+                (i & 2U) != 0 ? box.max_corner.y() : box.min_corner.y(),
+                (i & 4U) != 0 ? box.max_corner.z() : box.min_corner.z());
+            bounding_box.merge(AABB(to_world * corner, to_world * corner));
+        }
+    }
+
+    for (const Object* const emitter : this->object->emitters()) {
+        const auto* const triangle = dynamic_cast<const MeshTriangle*>(emitter);
+        if (triangle == nullptr) continue;
+        emissive_triangles.emplace_back(std::make_unique<MeshTriangle>(
+            *triangle->mesh, triangle->index, to_world));
+        world_emitters[emitter] = emissive_triangles.back().get();
+    }
+}
+
+Ray Instance::to_object_space(const Ray& ray) const {
+    return {to_object * ray.origin, to_object.linear() * ray.direction,
+            ray.min_t, ray.max_t};
+}
+
+Intersection Instance::intersect(const Ray& ray) const {
+    if (!bounding_box.intersect(ray)) return Intersection::NoIntersection();
+
+    Intersection hit = object->intersect(to_object_space(ray));
+    if (hit.has_intersection()) hit.instance = this;
+    return hit;
+}
+
+bool Instance::occluded(const Ray& ray) const {
+    if (!bounding_box.intersect(ray)) return false;
+    return object->occluded(to_object_space(ray));
+}
+
+bool Instance::occluded_primitive(const Ray& ray,
+                                  [[maybe_unused]] const uint32_t primitive)
+    const {
+    return occluded(ray);
+}
+
+std::vector<const Object*> Instance::emitters() const {
+    std::vector<const Object*> objects;
+    objects.reserve(emissive_triangles.size());
+    for (const auto& triangle : emissive_triangles) {
+        objects.emplace_back(triangle.get());
+    }
+    return objects;
+}
+
+const Object* Instance::emitter_at(const Intersection& intersection) const {
+    const Object* const emitter = intersection.object->emitter_at(intersection);
+    if (emitter == nullptr) return nullptr;
+    const auto it = world_emitters.find(emitter);
+    return it != world_emitters.end() ? it->second : nullptr;
+}
+
+SurfaceInteraction Instance::surface_at(
+    const Ray& ray, const Intersection& intersection) const {
+    const Ray object_ray = to_object_space(ray);
+    SurfaceInteraction surface = visit_geometry(
+        *intersection.object, [&](const auto& hit_object) {
+            return hit_object.surface_at(object_ray, intersection);
+        });
+
+    // The transformed normal still faces the ray, as the dot product of the
+    // normal and the direction is preserved.
+    const Eigen::Vector3f normal =
+        (normal_to_world * surface.normal).normalized();
+    const Eigen::Vector3f tangent =
+        to_world.linear() * surface.tangent_space.col(0);
+
+    surface.point = ray.origin + intersection.t * ray.direction;
+    surface.normal = normal;
+    surface.tangent_space =
+        SurfaceInteraction::make_tangent_space(normal, tangent);
+    return surface;
+}
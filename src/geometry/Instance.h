@@ -0,0 +1,79 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Geometry.h"
+#include "TriangleMesh.h"
+
+/**
+ * An object placed in the scene by a transform. The object is usually the
+ * BVH over the meshes of a file, shared by all the instances placing it, so
+ * that its primitives are stored once. Rays are transformed into the space of
+ * the object to be intersected.
+ */
+class Instance final : public Geometry {
+   public:
+    /**
+     * @param object Object in its own space.
+     * @param transform Affine transform from the space of the object to world
+     * space.
+     */
+    Instance(std::shared_ptr<const Geometry> object,
+             const Eigen::Affine3f& transform);
+
+    Instance(const Instance&) = delete;
+    Instance(Instance&&) = delete;
+    Instance& operator=(const Instance&) = delete;
+    Instance& operator=(Instance&&) = delete;
+    ~Instance() override = default;
+
+    [[nodiscard]] Intersection intersect(const Ray& ray) const override;
+
+    [[nodiscard]] bool occluded(const Ray& ray) const override;
+
+    [[nodiscard]] bool occluded_primitive(const Ray& ray,
+                                          uint32_t primitive) const override;
+
+    /**
+     * Get the emissive triangles of the object, placed in world space. Other
+     * emissive primitives of instanced objects are not sampled as lights.
+     */
+    [[nodiscard]] std::vector<const Object*> emitters() const override;
+
+    /**
+     * Get the emissive triangle in world space for a hit on the object.
+     */
+    [[nodiscard]] const Object* emitter_at(
+        const Intersection& intersection) const override;
+
+    /**
+     * Compute the shading information at a hit on the object, in world space.
+     */
+    [[nodiscard]] SurfaceInteraction surface_at(
+        const Ray& ray, const Intersection& intersection) const override;
+
+   private:
+    /**
+     * Transform a ray into the space of the object. The direction is not
+     * normalized, so that distances along the ray are the same in both
+     * spaces.
+     */
+    [[nodiscard]] Ray to_object_space(const Ray& ray) const;
+
+    std::shared_ptr<const Geometry> object;
+    Eigen::Affine3f to_world;
+    Eigen::Affine3f to_object;
+    // Transform of the normals to world space (inverse transpose).
+    Eigen::Matrix3f normal_to_world;
+    // Emissive triangles of the object in world space.
+    std::vector<std::unique_ptr<MeshTriangle>> emissive_triangles;
+    // Emissive triangle in world space of each emitter of the object.
+    std::unordered_map<const Object*, const MeshTriangle*> world_emitters;
+};
+
+#endif
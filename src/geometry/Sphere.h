@@ -1,32 +1,68 @@
 #ifndef SPHERE_H
 #define SPHERE_H
 
+#include <optional>
+
 #include "Geometry.h"
 
-class Sphere : public Geometry {
+class Sphere final : public Geometry {
    public:
     Sphere(Eigen::Vector3f center, float radius,
            std::shared_ptr<Material> material);
 
     [[nodiscard]] Intersection intersect(const Ray& ray) const override;
 
-    [[nodiscard]] Eigen::Vector3f normal_at(
-        const Ray& ray, const Eigen::Vector3f& point) const override;
-
-    [[nodiscard]] Eigen::Matrix3f tangent_space_at(
-        const Eigen::Vector3f& point,
-        const Eigen::Vector3f& normal) const override;
+    [[nodiscard]] SurfaceInteraction surface_at(
+        const Ray& ray, const Intersection& intersection) const override;
 
-    [[nodiscard]] Eigen::Vector2f texcoords_at(
-        const Eigen::Vector3f& point) const override;
-
-    [[nodiscard]] Ray ray_from(Eigen::Vector3f point) const override;
+    [[nodiscard]] Ray ray_from(Eigen::Vector3f point,
+                               Random& rng) const override;
 
     [[nodiscard]] float inv_pdf(const Ray& ray,
                                 const float distance) const override;
 
+    [[nodiscard]] float power(float scene_radius) const override;
+
+    [[nodiscard]] std::optional<LightBounds> light_bounds() const override;
+
     Eigen::Vector3f center;
     float radius;
+
+   private:
+    static constexpr float EPSILON = 1e-6F;
 };
 
+// Defined in the header so that it can be inlined into the BVH traversal.
+inline Intersection Sphere::intersect(const Ray& ray) const {
+    if (!bounding_box.intersect(ray)) {
+        return Intersection::NoIntersection();
+    }
+
+    const auto calc_t = [this](const Ray& ray) -> std::optional<float> {
+        const float a = ray.direction.squaredNorm();
+        const float b = 2 * ray.direction.dot(ray.origin - center);
+        const float c = (ray.origin - center).squaredNorm() - (radius * radius);
+        const float discriminant = (b * b) - (4 * a * c);
+
+        if (discriminant < EPSILON) return std::nullopt;
+
+        // smaller t
+        float t = (-b - std::sqrt(discriminant)) / (2 * a);
+        if (t > ray.max_t) return std::nullopt;
+        if (t >= ray.min_t) return t;
+
+        // larger t
+        t = (-b + std::sqrt(discriminant)) / (2 * a);
+        if (t > ray.max_t) return std::nullopt;
+        if (t >= ray.min_t) return t;
+
+        return std::nullopt;
+    };
+
+    const std::optional<float> t = calc_t(ray);
+    if (!t) return Intersection::NoIntersection();
+
+    return {this, *t};
+}
+
 #endif
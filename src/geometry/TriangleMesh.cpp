@@ -0,0 +1,223 @@
+#include "TriangleMesh.h"
+
+#include <Eigen/Dense>
+#include <cassert>
+#include <numbers>
+
+#include "../util/color.h"
+#include "../util/sampling.h"
+
+TriangleMesh::TriangleMesh(std::vector<Eigen::Vector3f> positions,
+                           std::vector<Eigen::Vector3f> normals,
+                           std::vector<Eigen::Vector2f> texcoords,
+                           std::vector<std::array<uint32_t, 3>> indices,
+                           std::shared_ptr<Material> material)
+    : Geometry(AABB(), std::move(material), GeometryType::TriangleMesh),
+      positions(std::move(positions)),
+      normals(std::move(normals)),
+      texcoords(std::move(texcoords)),
+      indices(std::move(indices)) {
+    assert(this->normals.empty() ||
+           this->normals.size() == this->positions.size());
+    assert(this->texcoords.empty() ||
+           this->texcoords.size() == this->positions.size());
+
+    for (uint32_t i = 0; i < num_primitives(); i++) {
+        bounding_box.merge(primitive_bounding_box(i));
+    }
+
+    if (this->material && this->material->emissive) {
+        emissive_triangles.reserve(this->indices.size());
+        for (uint32_t i = 0; i < num_primitives(); i++) {
+            emissive_triangles.emplace_back(
+                std::make_unique<MeshTriangle>(*this, i));
+        }
+    }
+}
+
+TriangleMesh::~TriangleMesh() = default;
+
+std::array<Eigen::Vector3f, 3> TriangleMesh::vertices_of(
+    const uint32_t primitive) const {
+    const auto& [i0, i1, i2] = indices[primitive];
+    return {positions[i0], positions[i1], positions[i2]};
+}
+
+Eigen::Vector3f TriangleMesh::geometric_normal(const uint32_t primitive) const {
+    const auto [v0, v1, v2] = vertices_of(primitive);
+    return (v1 - v0).cross(v2 - v0).normalized();
+}
+
+uint32_t TriangleMesh::num_primitives() const {
+    return static_cast<uint32_t>(indices.size());
+}
+
+AABB TriangleMesh::primitive_bounding_box(const uint32_t primitive) const {
+    const auto [v0, v1, v2] = vertices_of(primitive);
+    return {v0.cwiseMin(v1).cwiseMin(v2), v0.cwiseMax(v1).cwiseMax(v2)};
+}
+
+Intersection TriangleMesh::intersect(const Ray& ray) const {
+    if (!bounding_box.intersect(ray)) return Intersection::NoIntersection();
+
+    Intersection hit;
+    Ray closest_ray = ray;
+    for (uint32_t i = 0; i < num_primitives(); i++) {
+        const Intersection primitive_hit = intersect_primitive(closest_ray, i);
+        if (primitive_hit.has_intersection()) {
+            hit = primitive_hit;
+            closest_ray.max_t = hit.t;
+        }
+    }
+    return hit;
+}
+
+std::vector<const Object*> TriangleMesh::emitters() const {
+    std::vector<const Object*> objects;
+    objects.reserve(emissive_triangles.size());
+    for (const auto& triangle : emissive_triangles) {
+        objects.emplace_back(triangle.get());
+    }
+    return objects;
+}
+
+const Object* TriangleMesh::emitter_at(const Intersection& intersection) const {
+    if (emissive_triangles.empty()) return nullptr;
+    return emissive_triangles[intersection.primitive].get();
+}
+
+SurfaceInteraction TriangleMesh::surface_at(
+    const Ray& ray, const Intersection& intersection) const {
+    const auto& [i0, i1, i2] = indices[intersection.primitive];
+    const float u = 1.F - intersection.u - intersection.v;
+    const float v = intersection.u;
+    const float w = intersection.v;
+
+    const Eigen::Vector3f edge1 = positions[i1] - positions[i0];
+    const Eigen::Vector3f edge2 = positions[i2] - positions[i0];
+
+    Eigen::Vector3f normal;
+    if (normals.empty()) {
+        normal = edge1.cross(edge2).normalized();
+    } else {
+        normal =
+            (u * normals[i0] + v * normals[i1] + w * normals[i2]).normalized();
+    }
+    if (normal.dot(ray.direction) > 0.F) {
+        normal = -normal;
+    }
+
+    Eigen::Vector2f uv = Eigen::Vector2f::Zero();
+    Eigen::Vector3f tangent = Eigen::Vector3f::Zero();
+    if (!texcoords.empty()) {
+        uv = u * texcoords[i0] + v * texcoords[i1] + w * texcoords[i2];
+
+        // Tangent along the u texture coordinate
+        // https://learnopengl.com/Advanced-Lighting/Normal-Mapping
+        const Eigen::Vector2f delta_uv1 = texcoords[i1] - texcoords[i0];
+        const Eigen::Vector2f delta_uv2 = texcoords[i2] - texcoords[i0];
+        const float det =
+            delta_uv1.x() * delta_uv2.y() - delta_uv2.x() * delta_uv1.y();
+        if (std::abs(det) > EPSILON) {
+            tangent = (delta_uv2.y() * edge1 - delta_uv1.y() * edge2) / det;
+        }
+    }
+
+    return {
+        .point = ray.origin + intersection.t * ray.direction,
+        .normal = normal,
+        .texcoords = uv,
+        .tangent_space = SurfaceInteraction::make_tangent_space(normal, tangent),
+        .material = material.get(),
+    };
+}
+
+MeshTriangle::MeshTriangle(const TriangleMesh& mesh, const uint32_t index,
+                           const Eigen::Affine3f& transform)
+    : mesh(&mesh), index(index) {
+    const std::array<Eigen::Vector3f, 3> mesh_vertices =
+        mesh.vertices_of(index);
+    for (size_t i = 0; i < 3; i++) {
+        vertices.at(i) = transform * mesh_vertices.at(i);
+    }
+    const auto& [v0, v1, v2] = vertices;
+    const Eigen::Vector3f cross = (v1 - v0).cross(v2 - v0);
+    area = cross.norm() / 2;
+    normal = cross.normalized();
+}
+
+Ray MeshTriangle::ray_from(Eigen::Vector3f point, Random& rng) const {
+    if (samples_solid_angle(point)) {
+        // Sample the spherical triangle seen from the point
+        const std::optional<Eigen::Vector3f> barycentric =
+            sample_spherical_triangle(vertices, point, rng);
+        if (barycentric) {
+            const auto& [v0, v1, v2] = vertices;
+            const Eigen::Vector3f target_point = barycentric->x() * v0 +
+                                                 barycentric->y() * v1 +
+                                                 barycentric->z() * v2;
+            const Eigen::Vector3f diff = target_point - point;
+            return {std::move(point), diff.normalized(), 0.F, diff.norm()};
+        }
+    }
+
+    // Sample a random point on the triangle surface using barycentric
+    // coordinates.
+    float u = rng.uniform();
+    float v = rng.uniform();
+
+    // Reflect the mirrored triangle region onto the original triangle.
+    if (u + v > 1.0F) {
+        u = 1.0F - u;
+        v = 1.0F - v;
+    }
+
+    const float w = 1.0F - u - v;
+
+    const auto& [v0, v1, v2] = vertices;
+    const auto target_point = u * v0 + v * v1 + w * v2;
+    const Eigen::Vector3f diff = target_point - point;
+    const Eigen::Vector3f direction = diff.normalized();
+    const float distance = diff.norm();
+
+    return {std::move(point), direction, 0.F, distance};
+}
+
+bool MeshTriangle::samples_solid_angle(const Eigen::Vector3f& point) const {
+    const float solid_angle = triangle_solid_angle(vertices, point);
+    return solid_angle >= MIN_SPHERICAL_SOLID_ANGLE &&
+           solid_angle <= MAX_SPHERICAL_SOLID_ANGLE;
+}
+
+float MeshTriangle::inv_pdf(const Ray& ray, const float distance) const {
+    if (samples_solid_angle(ray.origin)) {
+        return triangle_solid_angle(vertices, ray.origin);
+    }
+
+    const auto cos_theta = std::abs(normal.dot(ray.direction));
+    return area * cos_theta / (distance * distance);
+}
+
+Eigen::Vector3f MeshTriangle::emission_at(
+    const Eigen::Vector2f& texcoords) const {
+    return mesh->material->emission->sample(texcoords);
+}
+
+float MeshTriangle::power(const float /*scene_radius*/) const {
+    // Radiance emitted over the hemispheres of both sides of the triangle
+    return 2 * std::numbers::pi_v<float> * area *
+           luminance(mesh->material->emission->average());
+}
+
+std::optional<LightBounds> MeshTriangle::light_bounds() const {
+    const auto& [v0, v1, v2] = vertices;
+    return LightBounds{
+        .bounds = AABB(v0.cwiseMin(v1).cwiseMin(v2),
+                       v0.cwiseMax(v1).cwiseMax(v2)),
+        .phi = power(0.F),
+        .w = normal,
+        .cos_theta_o = 1.F,
+        .cos_theta_e = 0.F,
+        .two_sided = true,
+    };
+}
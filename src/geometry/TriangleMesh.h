@@ -0,0 +1,170 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Geometry.h"
+
+class MeshTriangle;
+
+/**
+ * A mesh of triangles sharing a material. The vertex attributes are stored in
+ * separate buffers and referenced by the triangles through indices, so that
+ * shared vertices are stored once.
+ */
+class TriangleMesh final : public Geometry {
+   public:
+    /**
+     * @param positions Positions of the vertices.
+     * @param normals Normals of the vertices, or empty to use the geometric
+     * normals of the triangles.
+     * @param texcoords Texture coordinates of the vertices, or empty if the
+     * mesh is not textured.
+     * @param indices Indices of the three vertices of each triangle.
+     * @param material Material of the mesh.
+     */
+    TriangleMesh(std::vector<Eigen::Vector3f> positions,
+                 std::vector<Eigen::Vector3f> normals,
+                 std::vector<Eigen::Vector2f> texcoords,
+                 std::vector<std::array<uint32_t, 3>> indices,
+                 std::shared_ptr<Material> material);
+
+    TriangleMesh(const TriangleMesh&) = delete;
+    TriangleMesh(TriangleMesh&&) = delete;
+    TriangleMesh& operator=(const TriangleMesh&) = delete;
+    TriangleMesh& operator=(TriangleMesh&&) = delete;
+    ~TriangleMesh() override;
+
+    [[nodiscard]] Intersection intersect(const Ray& ray) const override;
+
+    [[nodiscard]] uint32_t num_primitives() const override;
+
+    [[nodiscard]] AABB primitive_bounding_box(
+        uint32_t primitive) const override;
+
+    [[nodiscard]] Intersection intersect_primitive(
+        const Ray& ray, uint32_t primitive) const override;
+
+    [[nodiscard]] std::vector<const Object*> emitters() const override;
+
+    [[nodiscard]] const Object* emitter_at(
+        const Intersection& intersection) const override;
+
+    [[nodiscard]] SurfaceInteraction surface_at(
+        const Ray& ray, const Intersection& intersection) const override;
+
+    /**
+     * Get the positions of the vertices of a triangle.
+     */
+    [[nodiscard]] std::array<Eigen::Vector3f, 3> vertices_of(
+        uint32_t primitive) const;
+
+    /**
+     * Get the unit geometric normal of a triangle.
+     */
+    [[nodiscard]] Eigen::Vector3f geometric_normal(uint32_t primitive) const;
+
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<Eigen::Vector2f> texcoords;
+    std::vector<std::array<uint32_t, 3>> indices;
+
+   private:
+    static constexpr float EPSILON = 1e-6F;
+
+    // Triangles sampled as light sources, if the material is emissive.
+    std::vector<std::unique_ptr<MeshTriangle>> emissive_triangles;
+};
+
+/**
+ * A triangle of a mesh, sampled as a light source.
+ */
+class MeshTriangle final : public Object {
+   public:
+    /**
+     * @param mesh Mesh of the triangle.
+     * @param index Index of the triangle in the mesh.
+     * @param transform Transform from the space of the mesh to world space,
+     * for instanced meshes.
+     */
+    MeshTriangle(
+        const TriangleMesh& mesh, uint32_t index,
+        const Eigen::Affine3f& transform = Eigen::Affine3f::Identity());
+
+    [[nodiscard]] Ray ray_from(Eigen::Vector3f point,
+                               Random& rng) const override;
+
+    [[nodiscard]] float inv_pdf(const Ray& ray,
+                                float distance) const override;
+
+    [[nodiscard]] Eigen::Vector3f emission_at(
+        const Eigen::Vector2f& texcoords) const override;
+
+    [[nodiscard]] float power(float scene_radius) const override;
+
+    [[nodiscard]] std::optional<LightBounds> light_bounds() const override;
+
+    const TriangleMesh* mesh;
+    // Index of the triangle in the mesh.
+    uint32_t index;
+
+   private:
+    // Range of solid angles in which the triangle is sampled as a spherical
+    // triangle. Smaller triangles gain little from it and larger ones lose
+    // precision, so they are sampled by area instead.
+    static constexpr float MIN_SPHERICAL_SOLID_ANGLE = 3e-4F;
+    static constexpr float MAX_SPHERICAL_SOLID_ANGLE = 6.22F;
+
+    /**
+     * Whether the triangle is sampled uniformly in solid angle, rather than
+     * in area, from a point.
+     */
+    [[nodiscard]] bool samples_solid_angle(const Eigen::Vector3f& point) const;
+
+    // Vertices in world space
+    std::array<Eigen::Vector3f, 3> vertices;
+    // Precomputed area
+    float area;
+    // Precomputed unit geometric normal
+    Eigen::Vector3f normal;
+};
+
+// Defined in the header so that it can be inlined into the BVH traversal.
+inline Intersection TriangleMesh::intersect_primitive(
+    const Ray& ray, const uint32_t primitive) const {
+    // Möller–Trumbore intersection algorithm
+    // https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+
+    const auto& [i0, i1, i2] = indices[primitive];
+    const Eigen::Vector3f& v0 = positions[i0];
+    const Eigen::Vector3f e1 = positions[i1] - v0;
+    const Eigen::Vector3f e2 = positions[i2] - v0;
+
+    // As tested, leaving auto to lazy evaluate is faster.
+
+    const auto h = ray.direction.cross(e2);
+    const float det = e1.dot(h);
+    if (std::abs(det) < EPSILON) return Intersection::NoIntersection();
+
+    const float inv_det = 1.F / det;
+
+    const auto s = ray.origin - v0;
+    const float u = inv_det * s.dot(h);
+    if (u < 0.F || u > 1.F) return Intersection::NoIntersection();
+
+    const auto q = s.cross(e1);
+    const float v = inv_det * ray.direction.dot(q);
+    if (v < 0.F || u + v > 1.F) return Intersection::NoIntersection();
+
+    const float t = inv_det * e2.dot(q);
+    if (t < ray.min_t || t > ray.max_t) return Intersection::NoIntersection();
+
+    return {this, t, primitive, u, v};
+}
+
+#endif
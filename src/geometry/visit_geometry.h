@@ -0,0 +1,29 @@
+#ifndef VISIT_GEOMETRY_H
+#define VISIT_GEOMETRY_H
+
+#include "Geometry.h"
+#include "Sphere.h"
+#include "TriangleMesh.h"
+
+/**
+ * Call a visitor with the geometry cast to its concrete type, so that the
+ * calls made by the visitor are dispatched statically.
+ *
+ * @param geometry Geometry to visit.
+ * @param visitor Callable accepting `const TriangleMesh&`, `const Sphere&` and
+ * `const Geometry&`.
+ * @return The value returned by the visitor.
+ */
+template <typename Visitor>
+decltype(auto) visit_geometry(const Geometry& geometry, Visitor&& visitor) {
+    switch (geometry.type) {
+        case GeometryType::TriangleMesh:
+            return visitor(static_cast<const TriangleMesh&>(geometry));
+        case GeometryType::Sphere:
+            return visitor(static_cast<const Sphere&>(geometry));
+        default:
+            return visitor(geometry);
+    }
+}
+
+#endif
@@ -1,10 +1,15 @@
 #include "DirectionalLight.h"
 
+#include <numbers>
+
+#include "../util/color.h"
+
 DirectionalLight::DirectionalLight(Eigen::Vector3f intensity,
                                    Eigen::Vector3f direction)
     : Light(std::move(intensity)), direction(direction.normalized()) {}
 
-Ray DirectionalLight::ray_from(Eigen::Vector3f point) const {
+Ray DirectionalLight::ray_from(Eigen::Vector3f point,
+                               Random& /*rng*/) const {
     return {std::move(point), -direction};
 }
 
@@ -12,3 +17,13 @@ float DirectionalLight::inv_pdf(const Ray& /*ray*/,
                                 const float /*distance*/) const {
     return 1.F;
 }
+
+float DirectionalLight::power(const float scene_radius) const {
+    // Irradiance falling on a disk that covers the scene
+    return std::numbers::pi_v<float> * scene_radius * scene_radius *
+           luminance(intensity);
+}
+
+std::optional<LightBounds> DirectionalLight::light_bounds() const {
+    return std::nullopt;
+}
@@ -7,11 +7,16 @@ class DirectionalLight : public Light {
    public:
     DirectionalLight(Eigen::Vector3f intensity, Eigen::Vector3f direction);
 
-    [[nodiscard]] Ray ray_from(Eigen::Vector3f point) const override;
+    [[nodiscard]] Ray ray_from(Eigen::Vector3f point,
+                               Random& rng) const override;
 
     [[nodiscard]] float inv_pdf(const Ray& ray,
                                 const float distance) const override;
 
+    [[nodiscard]] float power(float scene_radius) const override;
+
+    [[nodiscard]] std::optional<LightBounds> light_bounds() const override;
+
     // Direction _from_ light toward scene.
     Eigen::Vector3f direction;
 };
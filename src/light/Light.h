@@ -13,6 +13,9 @@ class Light : public Object {
     Light& operator=(Light&&) = delete;
     ~Light() override = default;
 
+    // Light sources are not part of the scene geometry.
+    [[nodiscard]] bool is_hittable() const override { return false; }
+
     [[nodiscard]] Eigen::Vector3f emission_at(
         const Eigen::Vector2f& /*texcoords*/) const override {
         return intensity;
@@ -0,0 +1,248 @@
+#include "LightBVH.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+namespace {
+
+static const float PI = std::numbers::pi_v<float>;
+
+// Number of buckets per axis evaluated when splitting a node.
+static const size_t NUM_BUCKETS = 12;
+
+/**
+ * Estimate the cost of a cluster of lights with the surface area orientation
+ * heuristic (SAOH): lights that are powerful, spread out, or emit in many
+ * directions are costly to keep together.
+ *
+ * @param bounds Bounds of the cluster.
+ * @param node_box Bounding box of the node being split.
+ * @param axis Axis along which the node is split.
+ */
+static float evaluate_cost(const LightBounds& bounds, const AABB& node_box,
+                           const int axis) {
+    const float theta_o = std::acos(std::clamp(bounds.cos_theta_o, -1.F, 1.F));
+    const float theta_e = std::acos(std::clamp(bounds.cos_theta_e, -1.F, 1.F));
+    const float theta_w = std::min(theta_o + theta_e, PI);
+    const float sin_theta_o =
+        std::sqrt(std::max(1 - bounds.cos_theta_o * bounds.cos_theta_o, 0.F));
+
+    // Solid angle of the emission directions, weighted by cosine
+    const float m_omega =
+        2 * PI * (1 - bounds.cos_theta_o) +
+        PI / 2 *
+            (2 * theta_w * sin_theta_o - std::cos(theta_o - 2 * theta_w) -
+             2 * theta_o * sin_theta_o + bounds.cos_theta_o);
+
+    // Penalize thin slabs, which the surface area underestimates
+    const Eigen::Vector3f dimensions = node_box.dimensions();
+    const float k_r = dimensions.maxCoeff() / dimensions[axis];
+
+    return bounds.phi * m_omega * k_r * bounds.bounds.surface_area();
+}
+
+}  // namespace
+
+LightBVH::LightBVH(const std::vector<const Object*>& lights) {
+    std::vector<BuildLight> build_lights;
+    for (const Object* const light : lights) {
+        const std::optional<LightBounds> bounds = light->light_bounds();
+        if (!bounds) {
+            infinite_lights.emplace_back(light);
+        } else if (bounds->phi > 0) {
+            // Lights that emit nothing are never chosen
+            build_lights.push_back({light, *bounds});
+        }
+    }
+    if (build_lights.empty()) return;
+
+    nodes.reserve(2 * build_lights.size() - 1);
+    parents.reserve(2 * build_lights.size() - 1);
+    bounded_lights.reserve(build_lights.size());
+    build(build_lights, 0, build_lights.size(), 0);
+
+    leaves.reserve(bounded_lights.size());
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].is_leaf) leaves[bounded_lights[nodes[i].index]] = i;
+    }
+}
+
+LightBounds LightBVH::build(std::vector<BuildLight>& build_lights,
+                            const size_t begin, const size_t end,
+                            const uint32_t parent) {
+    const auto node_index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    parents.emplace_back(parent);
+
+    if (end - begin == 1) {
+        const LightBounds& bounds = build_lights[begin].bounds;
+        nodes[node_index] = {bounds,
+                             static_cast<uint32_t>(bounded_lights.size()),
+                             true};
+        bounded_lights.emplace_back(build_lights[begin].light);
+        return bounds;
+    }
+
+    AABB node_box;
+    AABB centroid_box;
+    for (size_t i = begin; i < end; i++) {
+        const AABB& box = build_lights[i].bounds.bounds;
+        node_box.merge(box);
+        centroid_box.merge(AABB(box.center(), box.center()));
+    }
+    const Eigen::Vector3f extent = centroid_box.dimensions();
+
+    const auto bucket_of = [&](const BuildLight& light, const int axis) {
+        const float centroid = light.bounds.bounds.center()[axis];
+        const float offset =
+            (centroid - centroid_box.min_corner[axis]) / extent[axis];
+        return std::min(static_cast<size_t>(offset * NUM_BUCKETS),
+                        NUM_BUCKETS - 1);
+    };
+
+    // Find the bucket boundary of lowest SAOH cost over the three axes
+    float min_cost = std::numeric_limits<float>::infinity();
+    int min_axis = -1;
+    size_t min_bucket = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (!(extent[axis] > 0)) continue;
+
+        std::array<LightBounds, NUM_BUCKETS> buckets{};
+        for (size_t i = begin; i < end; i++) {
+            const size_t b = bucket_of(build_lights[i], axis);
+            buckets[b] = LightBounds::merge(buckets[b], build_lights[i].bounds);
+        }
+
+        for (size_t split = 0; split + 1 < NUM_BUCKETS; split++) {
+            LightBounds below;
+            LightBounds above;
+            for (size_t b = 0; b <= split; b++) {
+                below = LightBounds::merge(below, buckets[b]);
+            }
+            for (size_t b = split + 1; b < NUM_BUCKETS; b++) {
+                above = LightBounds::merge(above, buckets[b]);
+            }
+
+            const float cost = evaluate_cost(below, node_box, axis) +
+                               evaluate_cost(above, node_box, axis);
+            if (cost > 0 && cost < min_cost) {
+                min_cost = cost;
+                min_axis = axis;
+                min_bucket = split;
+            }
+        }
+    }
+
+    size_t mid = (begin + end) / 2;
+    if (min_axis != -1) {
+        const auto split_it = std::partition(
+            build_lights.begin() + static_cast<ptrdiff_t>(begin),
+            build_lights.begin() + static_cast<ptrdiff_t>(end),
+            [&](const BuildLight& light) {
+                return bucket_of(light, min_axis) <= min_bucket;
+            });
+        const auto split =
+            static_cast<size_t>(split_it - build_lights.begin());
+        // Fall back to splitting in halves if all the lights are on one side
+        if (split != begin && split != end) mid = split;
+    }
+
+    const LightBounds first = build(build_lights, begin, mid, node_index);
+    const auto second_index = static_cast<uint32_t>(nodes.size());
+    const LightBounds second = build(build_lights, mid, end, node_index);
+
+    const LightBounds bounds = LightBounds::merge(first, second);
+    nodes[node_index] = {bounds, second_index, false};
+    return bounds;
+}
+
+std::optional<LightBVH::Sample> LightBVH::sample(
+    const Eigen::Vector3f& point, const Eigen::Vector3f& normal,
+    Random& rng) const {
+    // Choose between the lights at infinity and the tree, as if the tree
+    // was one more light at infinity
+    float p_infinite = 0.F;
+    if (!infinite_lights.empty()) {
+        const auto num_infinite = static_cast<float>(infinite_lights.size());
+        p_infinite = num_infinite / (num_infinite + (nodes.empty() ? 0 : 1));
+        if (rng.uniform() < p_infinite) {
+            const uint32_t index = rng.uniform_int(
+                static_cast<uint32_t>(infinite_lights.size()));
+            return Sample{infinite_lights[index], p_infinite / num_infinite};
+        }
+    }
+    if (nodes.empty()) return std::nullopt;
+
+    // Descend the tree, choosing a child in proportion to its importance
+    float pmf = 1 - p_infinite;
+    uint32_t index = 0;
+    while (!nodes[index].is_leaf) {
+        const uint32_t first = index + 1;
+        const uint32_t second = nodes[index].index;
+        const float importance_first =
+            nodes[first].bounds.importance(point, normal);
+        const float importance_second =
+            nodes[second].bounds.importance(point, normal);
+        if (importance_first == 0 && importance_second == 0) {
+            return std::nullopt;
+        }
+
+        const float p_first =
+            importance_first / (importance_first + importance_second);
+        if (rng.uniform() < p_first) {
+            index = first;
+            pmf *= p_first;
+        } else {
+            index = second;
+            pmf *= 1 - p_first;
+        }
+    }
+
+    // The importance of a single light has not been checked yet
+    if (index == 0 && nodes[0].bounds.importance(point, normal) == 0) {
+        return std::nullopt;
+    }
+    return Sample{bounded_lights[nodes[index].index], pmf};
+}
+
+float LightBVH::pmf(const Eigen::Vector3f& point, const Eigen::Vector3f& normal,
+                    const Object* const light) const {
+    // Same choice between the lights at infinity and the tree as `sample()`
+    float p_infinite = 0.F;
+    if (!infinite_lights.empty()) {
+        const auto num_infinite = static_cast<float>(infinite_lights.size());
+        p_infinite = num_infinite / (num_infinite + (nodes.empty() ? 0 : 1));
+        if (std::ranges::find(infinite_lights, light) !=
+            infinite_lights.end()) {
+            return p_infinite / num_infinite;
+        }
+    }
+
+    const auto leaf = leaves.find(light);
+    if (leaf == leaves.end()) return 0.F;
+
+    // Walk up from the leaf, multiplying the probabilities of choosing each
+    // node over its sibling
+    float pmf = 1 - p_infinite;
+    uint32_t index = leaf->second;
+    if (index == 0) {
+        return nodes[0].bounds.importance(point, normal) > 0 ? pmf : 0.F;
+    }
+    while (index != 0) {
+        const uint32_t parent = parents[index];
+        const float importance_first =
+            nodes[parent + 1].bounds.importance(point, normal);
+        const float importance_second =
+            nodes[nodes[parent].index].bounds.importance(point, normal);
+        const float importance =
+            index == parent + 1 ? importance_first : importance_second;
+        if (importance == 0) return 0.F;
+
+        pmf *= importance / (importance_first + importance_second);
+        index = parent;
+    }
+    return pmf;
+}
@@ -0,0 +1,105 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "../Object.h"
+#include "../util/random.h"
+#include "LightBounds.h"
+
+/**
+ * Bounding volume hierarchy over the light sources, to choose a light in
+ * proportion to its estimated contribution to a shading point. Each node
+ * bounds the positions, emission directions and power of its lights, so that
+ * whole clusters of lights that are far, dim or facing away are rarely
+ * chosen, in time logarithmic in the number of lights.
+ *
+ * Lights at infinity have no bounds, and are chosen uniformly instead.
+ *
+ * Reference:
+ * https://pbr-book.org/4ed/Light_Sources/Light_Sampling#BVHLightSampling
+ */
+class LightBVH {
+   public:
+    struct Sample {
+        const Object* light;
+        // Probability of choosing the light.
+        float pmf;
+    };
+
+    LightBVH() = default;
+
+    /**
+     * Build the hierarchy.
+     *
+     * @param lights Light sources to choose from.
+     */
+    explicit LightBVH(const std::vector<const Object*>& lights);
+
+    /**
+     * Choose a light for a shading point.
+     *
+     * @param [in] point Shading point.
+     * @param [in] normal Unit normal at the shading point, facing the side
+     * that receives light.
+     * @param [in,out] rng Random number generator.
+     * @return Chosen light and its probability, or nullopt if no light can
+     * reach the point.
+     */
+    [[nodiscard]] std::optional<Sample> sample(const Eigen::Vector3f& point,
+                                               const Eigen::Vector3f& normal,
+                                               Random& rng) const;
+
+    /**
+     * Compute the probability that `sample()` chooses a light for a shading
+     * point.
+     *
+     * @param [in] point Shading point.
+     * @param [in] normal Unit normal at the shading point, facing the side
+     * that receives light.
+     * @param [in] light Light source.
+     * @return Probability of choosing the light.
+     */
+    [[nodiscard]] float pmf(const Eigen::Vector3f& point,
+                            const Eigen::Vector3f& normal,
+                            const Object* light) const;
+
+   private:
+    struct Node {
+        LightBounds bounds;
+        // Index of the light in a leaf, or of the second child in an inner
+        // node. The first child follows its parent.
+        uint32_t index;
+        bool is_leaf;
+    };
+
+    struct BuildLight {
+        const Object* light;
+        LightBounds bounds;
+    };
+
+    /**
+     * Build the subtree over `build_lights[begin, end)`, reordering them.
+     *
+     * @param parent Index of the parent node, ignored for the root.
+     * @return Bounds of the subtree.
+     */
+    LightBounds build(std::vector<BuildLight>& build_lights, size_t begin,
+                      size_t end, uint32_t parent);
+
+    std::vector<Node> nodes;
+    // Index of the parent of each node, to walk up from a leaf
+    std::vector<uint32_t> parents;
+    // Index of the leaf of each light in the tree
+    std::unordered_map<const Object*, uint32_t> leaves;
+    // Lights referenced by the leaves
+    std::vector<const Object*> bounded_lights;
+    // Lights at infinity
+    std::vector<const Object*> infinite_lights;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "LightBounds.h"
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+static const float PI = std::numbers::pi_v<float>;
+
+static float safe_sqrt(const float x) { return std::sqrt(std::max(x, 0.F)); }
+
+static float safe_acos(const float x) {
+    return std::acos(std::clamp(x, -1.F, 1.F));
+}
+
+/**
+ * Cosine of max(0, a - b), given the sines and cosines of the angles a and b.
+ */
+static float cos_sub_clamped(const float sin_a, const float cos_a,
+                             const float sin_b, const float cos_b) {
+    if (cos_a > cos_b) return 1.F;
+    return cos_a * cos_b + sin_a * sin_b;
+}
+
+/**
+ * Sine of max(0, a - b), given the sines and cosines of the angles a and b.
+ */
+static float sin_sub_clamped(const float sin_a, const float cos_a,
+                             const float sin_b, const float cos_b) {
+    if (cos_a > cos_b) return 0.F;
+    return sin_a * cos_b - cos_a * sin_b;
+}
+
+/**
+ * Merge two cones of directions into the smallest cone containing both.
+ *
+ * @param [in,out] w_a Axis of the first cone, replaced by the merged axis.
+ * @param [in,out] cos_a Cosine of the half-angle of the first cone, replaced
+ * by the merged one.
+ */
+static void merge_cones(Eigen::Vector3f& w_a, float& cos_a,
+                        const Eigen::Vector3f& w_b, const float cos_b) {
+    const float theta_a = safe_acos(cos_a);
+    const float theta_b = safe_acos(cos_b);
+    const float theta_d = safe_acos(w_a.dot(w_b));
+
+    // One cone contains the other
+    if (std::min(theta_d + theta_b, PI) <= theta_a) return;
+    if (std::min(theta_d + theta_a, PI) <= theta_b) {
+        w_a = w_b;
+        cos_a = cos_b;
+        return;
+    }
+
+    const float theta_o = (theta_a + theta_d + theta_b) / 2;
+    const Eigen::Vector3f axis = w_a.cross(w_b);
+    if (theta_o >= PI || axis.squaredNorm() == 0.F) {
+        // The whole sphere of directions
+        cos_a = -1.F;
+        return;
+    }
+
+    // Rotate the first axis toward the second one, to the middle of the
+    // merged cone
+    w_a = Eigen::AngleAxisf(theta_o - theta_a, axis.normalized()) * w_a;
+    cos_a = std::cos(theta_o);
+}
+
+}  // namespace
+
+LightBounds LightBounds::merge(const LightBounds& a, const LightBounds& b) {
+    if (a.phi == 0.F) return b;
+    if (b.phi == 0.F) return a;
+
+    LightBounds merged = a;
+    merged.bounds.merge(b.bounds);
+    merged.phi += b.phi;
+    merge_cones(merged.w, merged.cos_theta_o, b.w, b.cos_theta_o);
+    merged.cos_theta_e = std::min(a.cos_theta_e, b.cos_theta_e);
+    merged.two_sided = a.two_sided || b.two_sided;
+    return merged;
+}
+
+float LightBounds::importance(const Eigen::Vector3f& point,
+                              const Eigen::Vector3f& normal) const {
+    const float radius = bounds.dimensions().norm() / 2;
+    const Eigen::Vector3f offset = point - bounds.center();
+    const float distance2 = offset.squaredNorm();
+    // Avoid the singularity of points close to the lights
+    const float clamped_distance2 = std::max(distance2, radius);
+
+    // Inside the bounding sphere, the lights may face the point from any
+    // direction.
+    if (distance2 <= radius * radius) return phi / clamped_distance2;
+
+    const float inv_distance = 1 / std::sqrt(distance2);
+    const Eigen::Vector3f direction = offset * inv_distance;
+
+    // Angle between the axis of the cone and the direction to the point
+    float cos_theta_w = w.dot(direction);
+    if (two_sided) cos_theta_w = std::abs(cos_theta_w);
+    const float sin_theta_w = safe_sqrt(1 - cos_theta_w * cos_theta_w);
+
+    // Half-angle of the cone of directions from the point to the bounding
+    // sphere
+    const float sin_theta_b = radius * inv_distance;
+    const float cos_theta_b = safe_sqrt(1 - sin_theta_b * sin_theta_b);
+
+    // Smallest angle between the emitting normals and the point, over all
+    // the positions in the bounds
+    const float sin_theta_o = safe_sqrt(1 - cos_theta_o * cos_theta_o);
+    const float cos_theta_x =
+        cos_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    const float sin_theta_x =
+        sin_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    const float cos_theta_p =
+        cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+    if (cos_theta_p <= cos_theta_e) return 0.F;
+
+    // Smallest angle of incidence at the point, over all the positions in the
+    // bounds
+    const float cos_theta_i = -normal.dot(direction);
+    const float sin_theta_i = safe_sqrt(1 - cos_theta_i * cos_theta_i);
+    const float cos_theta_pi =
+        cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+
+    return std::max(phi * cos_theta_p * cos_theta_pi / clamped_distance2, 0.F);
+}
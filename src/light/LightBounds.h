@@ -0,0 +1,48 @@
+#ifndef LIGHT_BOUNDS_H
+#define LIGHT_BOUNDS_H
+
+#include <Eigen/Core>
+
+#include "../bvh/AABB.h"
+
+/**
+ * Bounds of the emission of one or more light sources: where they are, in
+ * which directions they emit, and how much. Used to estimate the contribution
+ * of a cluster of lights to a point without sampling them.
+ *
+ * Reference:
+ * https://pbr-book.org/4ed/Light_Sources/Light_Sampling#BVHLightSampling
+ */
+struct LightBounds {
+    // Bounding box of the emitting surfaces.
+    AABB bounds;
+    // Luminance of the total emitted power.
+    float phi = 0.F;
+    // Axis of the cone bounding the surface normals (or emission directions).
+    Eigen::Vector3f w = Eigen::Vector3f::UnitZ();
+    // Cosine of the half-angle of the cone of normals.
+    float cos_theta_o = 1.F;
+    // Cosine of the angle beyond the normals at which emission falls to zero.
+    float cos_theta_e = 1.F;
+    // Whether the surfaces emit on both sides.
+    bool two_sided = false;
+
+    /**
+     * Bound the emission of two clusters of lights together.
+     */
+    [[nodiscard]] static LightBounds merge(const LightBounds& a,
+                                           const LightBounds& b);
+
+    /**
+     * Estimate an upper bound of the contribution of the lights to a point.
+     *
+     * @param point Receiving point.
+     * @param normal Unit normal at the point, facing the side that receives
+     * light.
+     * @return Importance of the lights, zero if they cannot light the point.
+     */
+    [[nodiscard]] float importance(const Eigen::Vector3f& point,
+                                   const Eigen::Vector3f& normal) const;
+};
+
+#endif
@@ -2,7 +2,8 @@
 
 #include <numbers>
 
-#include "../util/random.h"
+#include "../util/color.h"
+#include "../util/sampling.h"
 
 PointLight::PointLight(Eigen::Vector3f intensity, Eigen::Vector3f position,
                        const float radius)
@@ -10,15 +11,17 @@ PointLight::PointLight(Eigen::Vector3f intensity, Eigen::Vector3f position,
       position(std::move(position)),
       radius(radius) {}
 
-Ray PointLight::ray_from(Eigen::Vector3f point) const {
-    // Sample a random point on the sphere surface
-    // https://devforum.roblox.com/t/how-to-generate-a-random-rotation-and-much-more/1549051
-    std::uniform_real_distribution<float> uniform_dist(0.F, 1.F);
-    const float a = 2 * std::numbers::pi_v<float> * uniform_dist(rng);
-    const float x = 2 * uniform_dist(rng) - 1;
-    const float r = std::sqrt(1 - x * x);
-    Eigen::Vector3f d = {x, r * std::cos(a), r * std::sin(a)};
-    const auto target_point = this->position + radius * d;
+Ray PointLight::ray_from(Eigen::Vector3f point, Random& rng) const {
+    // Sample the cap of the sphere visible from the point, or the whole
+    // surface from inside.
+    Eigen::Vector3f target_point = position;
+    if (radius > 0) {
+        target_point =
+            (point - position).squaredNorm() > radius * radius
+                ? sample_sphere_cone(position, radius, point, rng)
+                : Eigen::Vector3f(position +
+                                  radius * sample_uniform_sphere(rng));
+    }
 
     const Eigen::Vector3f diff = target_point - point;
     const Eigen::Vector3f direction = diff.normalized();
@@ -27,8 +30,29 @@ Ray PointLight::ray_from(Eigen::Vector3f point) const {
     return {std::move(point), direction, 0.F, distance};
 }
 
-float PointLight::inv_pdf(const Ray& /*ray*/, const float distance) const {
-    // Total radiance should not depend on the size of the light source,
-    // so we fix area = 1.
+float PointLight::inv_pdf(const Ray& ray, const float distance) const {
+    // Total radiance should not depend on the size of the light source, so
+    // the intensity is spread over the projected area of the sphere, which
+    // tends to 1 / distance^2 as the radius shrinks.
+    if (radius > 0 && (ray.origin - position).squaredNorm() > radius * radius) {
+        return sphere_solid_angle(position, radius, ray.origin) /
+               (std::numbers::pi_v<float> * radius * radius);
+    }
     return 1 / (distance * distance);
 }
+
+float PointLight::power(const float /*scene_radius*/) const {
+    // Radiant intensity emitted uniformly in all directions
+    return 4 * std::numbers::pi_v<float> * luminance(intensity);
+}
+
+std::optional<LightBounds> PointLight::light_bounds() const {
+    const Eigen::Vector3f extent = Eigen::Vector3f::Constant(radius);
+    return LightBounds{
+        .bounds = AABB(position - extent, position + extent),
+        .phi = power(0.F),
+        // Emits in all directions
+        .cos_theta_o = -1.F,
+        .cos_theta_e = 0.F,
+    };
+}
@@ -8,11 +8,16 @@ class PointLight : public Light {
     PointLight(Eigen::Vector3f intensity, Eigen::Vector3f position,
                float radius);
 
-    [[nodiscard]] Ray ray_from(Eigen::Vector3f point) const override;
+    [[nodiscard]] Ray ray_from(Eigen::Vector3f point,
+                               Random& rng) const override;
 
     [[nodiscard]] float inv_pdf(const Ray& ray,
                                 const float distance) const override;
 
+    [[nodiscard]] float power(float scene_radius) const override;
+
+    [[nodiscard]] std::optional<LightBounds> light_bounds() const override;
+
     Eigen::Vector3f position;
     float radius;
 };
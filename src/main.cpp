@@ -1,10 +1,13 @@
+#include <getopt.h>
 #include <unistd.h>
 
 #include <Eigen/Core>
+#include <array>
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <string>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -13,25 +16,70 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
+#include "bvh/AABBTree.h"
+#include "bvh/BVHStats.h"
 #include "reader/gamma_transform.h"
 #include "reader/read_json.h"
 #include "render.h"
 
+namespace {
+
+/**
+ * Write a linear color image to a PNG file in sRGB.
+ */
+static void write_png(const std::string& filename,
+                      const std::vector<Eigen::Vector3f>& image,
+                      const int width, const int height) {
+    std::vector<unsigned char> output(image.size() * 3);
+
+    for (size_t i = 0; i < image.size(); i++) {
+        auto color = image[i]
+                         .cwisePow(1.F / GAMMA_SRGB)
+                         .cwiseMax(Eigen::Vector3f::Zero())
+                         .cwiseMin(Eigen::Vector3f::Ones());
+
+        const Eigen::Vector3<unsigned char> pixel =
+            (std::numeric_limits<unsigned char>::max() * color)
+                .cast<unsigned char>();
+
+        output[3 * i + 0] = pixel(0);
+        output[3 * i + 1] = pixel(1);
+        output[3 * i + 2] = pixel(2);
+    }
+
+    stbi_write_png(filename.c_str(), width, height, 3, output.data(),
+                   3 * width);
+}
+
+}  // namespace
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage: " << argv[0]
-                  << " <scene.json> [-o <output.png>]\n";
+                  << " <scene.json> [-o <output.png>]"
+                     " [--bvh-stats <stats.json>]\n";
         exit(EXIT_FAILURE);
     }
 
     std::string output_filename = "output.png";
+    // File the BVH statistics are written to, or empty to not collect them.
+    std::string bvh_stats_filename;
+
+    const std::array<option, 2> long_options = {{
+        {"bvh-stats", required_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0},
+    }};
 
     int c = 0;
-    while ((c = getopt(argc, argv, "o:")) != -1) {
+    while ((c = getopt_long(argc, argv, "o:", long_options.data(),
+                            nullptr)) != -1) {
         switch (c) {
             case 'o':
                 output_filename = std::string(optarg);
                 break;
+            case 's':
+                bvh_stats_filename = std::string(optarg);
+                break;
             case '?':
                 exit(EXIT_FAILURE);
             default:
@@ -43,29 +91,29 @@ int main(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    const Scene scene = read_json(argv[optind]);
+    const Scene scene = read_json(argv[optind], !bvh_stats_filename.empty());
 
     const int width = static_cast<int>(scene.camera.resolution_x);
     const int height = static_cast<int>(scene.camera.resolution_y);
 
-    std::vector<Eigen::Vector3f> image = render(scene);
-    std::vector<unsigned char> output(image.size() * 3);
-
-    for (size_t i = 0; i < image.size(); i++) {
-        auto color = image[i]
-                         .cwisePow(1.F / GAMMA_SRGB)
-                         .cwiseMax(Eigen::Vector3f::Zero())
-                         .cwiseMin(Eigen::Vector3f::Ones());
-
-        const Eigen::Vector3<unsigned char> pixel =
-            (std::numeric_limits<unsigned char>::max() * color)
-                .cast<unsigned char>();
+    // Intermediate images of progressive rendering are written to the output
+    // file, and replaced by the final image.
+    const std::vector<Eigen::Vector3f> image =
+        render(scene, [&](const std::vector<Eigen::Vector3f>& preview) {
+            write_png(output_filename, preview, width, height);
+        });
+    write_png(output_filename, image, width, height);
 
-        output[3 * i + 0] = pixel(0);
-        output[3 * i + 1] = pixel(1);
-        output[3 * i + 2] = pixel(2);
+    if (!bvh_stats_filename.empty()) {
+        const auto* const tree =
+            dynamic_cast<const AABBTree*>(scene.geometries.get());
+        if (tree == nullptr) {
+            std::cout << "No BVH was built for the scene.\n";
+        } else {
+            const BVHStats stats = compute_bvh_stats(*tree, scene.options.bvh,
+                                                     scene.bvh_build_time);
+            print_bvh_stats(stats);
+            write_bvh_stats(stats, bvh_stats_filename);
+        }
     }
-
-    stbi_write_png(output_filename.c_str(), width, height, 3, output.data(),
-                   3 * width);
 }
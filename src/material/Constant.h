@@ -12,6 +12,8 @@ class Constant : public Sampler<T> {
         return value;
     }
 
+    [[nodiscard]] T average() const override { return value; }
+
    private:
     T value;
 };
@@ -14,6 +14,11 @@ class Sampler {
     virtual ~Sampler() = default;
 
     [[nodiscard]] virtual T sample(const Eigen::Vector2f& uv) const = 0;
+
+    /**
+     * Get the average value over the whole texture space.
+     */
+    [[nodiscard]] virtual T average() const = 0;
 };
 
 using SamplerGray = Sampler<float>;
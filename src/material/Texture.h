@@ -8,7 +8,10 @@ class Texture : public Sampler<T> {
    public:
     Texture(const unsigned int width, const unsigned int height,
             std::vector<T> data)
-        : width(width), height(height), data(std::move(data)) {
+        : width(width),
+          height(height),
+          data(std::move(data)),
+          mean(compute_mean(this->data)) {
         data.shrink_to_fit();
     }
 
@@ -40,10 +43,20 @@ class Texture : public Sampler<T> {
                ty * ((1 - tx) * c01 + tx * c11);
     }
 
+    [[nodiscard]] T average() const override { return mean; }
+
    private:
+    static T compute_mean(const std::vector<T>& data) {
+        T sum = data.front();
+        for (size_t i = 1; i < data.size(); i++) sum += data[i];
+        return sum / static_cast<float>(data.size());
+    }
+
     unsigned int width;
     unsigned int height;
     std::vector<T> data;
+    // Precomputed average of the texels
+    T mean;
 };
 
 using TextureGray = Texture<float>;
@@ -9,115 +9,220 @@
 #include "path_tracing.h"
 
 #include <Eigen/Core>
+#include <algorithm>
+#include <optional>
 
 #include "Intersection.h"
+#include "SurfaceInteraction.h"
 #include "brdf.h"
-#include "util/random.h"
+#include "geometry/visit_geometry.h"
 
 namespace {
 
-static const int MAX_BOUNCES = 8;
-static const float PROBABILITY_SAMPLE_INDIRECT = 0.5F;
+// Upper bound of the probability to continue a path in Russian roulette, so
+// that paths with high throughput are still terminated eventually.
+static const float MAX_CONTINUE_PROBABILITY = 0.95F;
 
 static const float EPSILON = 1e-6F;
 static const float RAY_EPSILON = 1e-5F;
 
-static Eigen::Vector3f path_trace(const Ray& ray, const Scene& scene,
-                                  const int bounces) {
-    if (bounces > MAX_BOUNCES) return Eigen::Vector3f::Zero();
-
-    const Intersection intersection = scene.geometries->intersect(ray);
-    if (!intersection.has_intersection()) return Eigen::Vector3f::Zero();
-
-    const Eigen::Vector3f surface_point =
-        ray.origin + intersection.t * ray.direction;
-    Eigen::Vector3f normal = intersection.object->normal_at(ray, surface_point);
-    const Eigen::Vector2f texcoords =
-        intersection.object->texcoords_at(surface_point);
+/**
+ * Weight a sample with the power heuristic of multiple importance sampling.
+ * Both densities may be scaled by the same factor.
+ *
+ * @param pdf Density of the strategy that generated the sample.
+ * @param other_pdf Density of the other strategy for the same sample.
+ * @return Weight of the sample.
+ */
+static float power_heuristic(const float pdf, const float other_pdf) {
+    const float pdf2 = pdf * pdf;
+    const float sum = pdf2 + other_pdf * other_pdf;
+    return sum > 0 ? pdf2 / sum : 0.F;
+}
 
-    // Apply normal mapping
-    if (intersection.object->material->normal) {
-        Eigen::Vector3f normal_local =
-            intersection.object->material->normal->sample(texcoords);
-        normal_local =
-            ((2 * normal_local) - Eigen::Vector3f::Ones()).normalized();
-        const Eigen::Matrix3f tbn =
-            intersection.object->tangent_space_at(surface_point, normal);
-        normal = (tbn * normal_local).normalized();
+/**
+ * Compute the probability of choosing a light for a shading point, with the
+ * light sampler of the scene.
+ */
+static float light_pmf(const Scene& scene, const Object* const light,
+                       const Eigen::Vector3f& point,
+                       const Eigen::Vector3f& normal) {
+    if (scene.options.light_sampler == LightSampler::BVH) {
+        return scene.light_bvh.pmf(point, normal, light);
     }
+    const auto it = scene.emissive_indices.find(light);
+    if (it == scene.emissive_indices.end()) return 0.F;
+    return scene.light_distribution.pmf(it->second);
+}
 
-    // Contribution from a light source
-    const auto sample_direct = [&]() -> Eigen::Vector3f {
-        // Sample a light or an emissive material
-        const size_t num_lights = scene.emissive_objects.size();
-        std::uniform_int_distribution<size_t> random_light(0, num_lights - 1);
-        const auto light = scene.emissive_objects[random_light(rng)];
-
-        Ray ray_to_light = light->ray_from(surface_point);
-        const float distance = ray_to_light.max_t;
-
-        // Check if the light is facing the surface
-        const float cos_theta = normal.dot(ray_to_light.direction);
-        if (cos_theta <= EPSILON) return Eigen::Vector3f::Zero();
-
-        // Check for occlusion
-        ray_to_light.min_t += RAY_EPSILON;
-        ray_to_light.max_t -= RAY_EPSILON;
-        const Intersection ray_to_light_intersection =
-            scene.geometries->intersect(ray_to_light);
-        if (ray_to_light_intersection.has_intersection())
-            return Eigen::Vector3f::Zero();
-
-        const float inv_pdf = light->inv_pdf(ray_to_light, distance);
-        const auto brdf_value =
-            brdf(ray, ray_to_light, intersection, normal, texcoords);
-
-        // emission * brdf * cos_theta / (pdf / num_lights)
-        return light->emission_at(texcoords).cwiseProduct(brdf_value) *
-               cos_theta * inv_pdf * num_lights;
-    };
-
-    // Contribution from indirect lighting
-    const auto sample_indirect = [&]() -> Eigen::Vector3f {
-        Ray reflected_ray =
-            brdf_sample(ray, intersection, surface_point, normal, texcoords);
-        reflected_ray.min_t += RAY_EPSILON;
+/**
+ * Estimate the radiance reflected at a surface point from a randomly chosen
+ * light source.
+ *
+ * @param mis Whether the path continues in a direction sampled from the
+ * BRDF, so that light sources it can hit are weighted by multiple importance
+ * sampling.
+ */
+static Eigen::Vector3f sample_direct(const Ray& ray, const Scene& scene,
+                                     const SurfaceInteraction& surface,
+                                     const bool mis, Random& rng) {
+    // Choose a light or an emissive material
+    if (scene.emissive_objects.empty()) return Eigen::Vector3f::Zero();
+    const Object* light = nullptr;
+    float pmf = 0.F;
+    if (scene.options.light_sampler == LightSampler::BVH) {
+        const std::optional<LightBVH::Sample> sample =
+            scene.light_bvh.sample(surface.point, surface.normal, rng);
+        if (!sample) return Eigen::Vector3f::Zero();
+        light = sample->light;
+        pmf = sample->pmf;
+    } else {
+        const uint32_t index = scene.light_distribution.sample(rng);
+        light = scene.emissive_objects[index];
+        pmf = scene.light_distribution.pmf(index);
+    }
 
-        const float cos_theta = normal.dot(reflected_ray.direction);
-        if (cos_theta <= EPSILON) return Eigen::Vector3f::Zero();
+    Ray ray_to_light = light->ray_from(surface.point, rng);
+    const float distance = ray_to_light.max_t;
 
-        const auto brdf_value =
-            brdf(ray, reflected_ray, intersection, normal, texcoords);
-        const float pdf =
-            brdf_pdf(ray, reflected_ray, intersection, normal, texcoords);
+    // Check if the light is facing the surface
+    const float cos_theta = surface.normal.dot(ray_to_light.direction);
+    if (cos_theta <= EPSILON) return Eigen::Vector3f::Zero();
 
-        // L * brdf * cos_theta / pdf
-        return path_trace(reflected_ray, scene, bounces + 1)
-                   .cwiseProduct(brdf_value) *
-               cos_theta / (pdf + EPSILON);
-    };
+    // Check for occlusion
+    ray_to_light.min_t += RAY_EPSILON;
+    ray_to_light.max_t -= RAY_EPSILON;
+    if (scene.geometries->occluded(ray_to_light)) {
+        return Eigen::Vector3f::Zero();
+    }
 
-    Eigen::Vector3f color = sample_direct();
+    const float inv_pdf = light->inv_pdf(ray_to_light, distance);
+    const auto brdf_value = brdf(ray, ray_to_light, surface);
 
-    // Russian roulette for indirect lighting
-    std::uniform_real_distribution<float> uniform_dist(0.F, 1.F);
-    if (uniform_dist(rng) < PROBABILITY_SAMPLE_INDIRECT) {
-        color += sample_indirect() / PROBABILITY_SAMPLE_INDIRECT;
+    // Densities of light and BRDF sampling, both multiplied by inv_pdf
+    float weight = 1.F;
+    if (mis && light->is_hittable()) {
+        weight = power_heuristic(
+            pmf, brdf_pdf(ray, ray_to_light, surface) * inv_pdf);
     }
 
-    // Ignore emission for indirect bounces, since they are accounted for in
-    // direct lighting sampling
-    if (bounces == 0) {
-        color += intersection.object->emission_at(texcoords);
-    }
+    // emission * brdf * cos_theta / (pdf * pmf)
+    return light->emission_at(surface.texcoords).cwiseProduct(brdf_value) *
+           (cos_theta * inv_pdf * weight / pmf);
+}
 
-    color = color.cwiseMin(scene.options.ray_clamp);
+/**
+ * Compute the shading information at a surface hit, with normal mapping
+ * applied. The geometry is dispatched statically on its type, unless it is
+ * hit through an instance, which transforms the hit to world space.
+ */
+static SurfaceInteraction surface_at(const Ray& ray,
+                                     const Intersection& intersection) {
+    SurfaceInteraction surface =
+        intersection.instance != nullptr
+            ? intersection.instance->surface_at(ray, intersection)
+            : visit_geometry(*intersection.object, [&](const auto& object) {
+                  return object.surface_at(ray, intersection);
+              });
+
+    // Apply normal mapping
+    if (surface.material->normal) {
+        Eigen::Vector3f normal_local =
+            surface.material->normal->sample(surface.texcoords);
+        normal_local =
+            ((2 * normal_local) - Eigen::Vector3f::Ones()).normalized();
+        surface.set_normal((surface.tangent_space * normal_local).normalized());
+    }
 
-    return color;
+    return surface;
 }
 
 }  // namespace
 
-Eigen::Vector3f sample(const Ray& ray, const Scene& scene) {
-    return path_trace(ray, scene, 0);
+Eigen::Vector3f sample(const Ray& camera_ray, const Scene& scene,
+                       Random& rng) {
+    // Radiance gathered along the path so far.
+    Eigen::Vector3f radiance = Eigen::Vector3f::Zero();
+    // Product of brdf * cos_theta / pdf of all the bounces so far, i.e. the
+    // weight of radiance arriving along the current ray.
+    Eigen::Vector3f throughput = Eigen::Vector3f::Ones();
+
+    // Shading point, normal and BRDF PDF of the previous bounce, to weight
+    // the emission hit by the current ray against light sampling.
+    Eigen::Vector3f previous_point;
+    Eigen::Vector3f previous_normal;
+    float previous_pdf = 0.F;
+
+    Ray ray = camera_ray;
+    for (unsigned int bounces = 0;; bounces++) {
+        const Intersection intersection = scene.geometries->intersect(ray);
+        if (!intersection.has_intersection()) break;
+
+        const SurfaceInteraction surface = surface_at(ray, intersection);
+
+        // Contribution from a light source
+        const bool continues = bounces != scene.options.max_bounces;
+        radiance += throughput
+                        .cwiseProduct(
+                            sample_direct(ray, scene, surface, continues, rng))
+                        .cwiseMin(scene.options.ray_clamp);
+
+        // Emission seen by the camera, or hit by a direction sampled from the
+        // BRDF. The latter is also found by light sampling at the previous
+        // bounce, so both are weighted by multiple importance sampling.
+        if (bounces == 0) {
+            radiance += surface.material->emission->sample(surface.texcoords)
+                            .cwiseMin(scene.options.ray_clamp);
+        } else if (surface.material->emissive) {
+            const Geometry& hit = intersection.instance != nullptr
+                                      ? *intersection.instance
+                                      : *intersection.object;
+            const Object* const emitter = hit.emitter_at(intersection);
+            float weight = 1.F;
+            if (emitter != nullptr) {
+                // Densities of BRDF and light sampling, both multiplied by
+                // inv_pdf
+                const float pmf = light_pmf(scene, emitter, previous_point,
+                                            previous_normal);
+                weight = power_heuristic(
+                    previous_pdf * emitter->inv_pdf(ray, intersection.t), pmf);
+            }
+            const Eigen::Vector3f emission =
+                surface.material->emission->sample(surface.texcoords);
+            radiance += (throughput.cwiseProduct(emission) * weight)
+                            .cwiseMin(scene.options.ray_clamp);
+        }
+
+        if (!continues) break;
+
+        // Continue the path in a direction sampled from the BRDF
+        Ray reflected_ray = brdf_sample(ray, surface, rng);
+        reflected_ray.min_t += RAY_EPSILON;
+
+        const float cos_theta = surface.normal.dot(reflected_ray.direction);
+        if (cos_theta <= EPSILON) break;
+
+        const auto brdf_value = brdf(ray, reflected_ray, surface);
+        const float pdf = brdf_pdf(ray, reflected_ray, surface);
+
+        // brdf * cos_theta / pdf
+        throughput =
+            throughput.cwiseProduct(brdf_value) * cos_theta / (pdf + EPSILON);
+        ray = reflected_ray;
+        previous_point = surface.point;
+        previous_normal = surface.normal;
+        previous_pdf = pdf;
+
+        // Russian roulette: continue the path with a probability proportional
+        // to its throughput, so that dim paths are terminated early while
+        // bright paths are kept.
+        if (bounces + 1 >= scene.options.russian_roulette_depth) {
+            const float probability =
+                std::min(throughput.maxCoeff(), MAX_CONTINUE_PROBABILITY);
+            if (rng.uniform() >= probability) break;
+            throughput /= probability;
+        }
+    }
+
+    return radiance;
 }
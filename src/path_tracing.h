@@ -4,15 +4,18 @@
 #include <Eigen/Core>
 
 #include "Scene.h"
+#include "util/random.h"
 
 /**
  * Samples the color along a ray in the scene.
  *
- * @param ray The ray to be traced.
+ * @param camera_ray The ray to be traced.
  * @param scene The scene.
+ * @param rng The random number generator.
  *
  * @return The sampled color.
  */
-Eigen::Vector3f sample(const Ray& ray, const Scene& scene);
+Eigen::Vector3f sample(const Ray& camera_ray, const Scene& scene,
+                       Random& rng);
 
 #endif
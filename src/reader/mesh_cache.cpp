@@ -0,0 +1,19 @@
+#include "mesh_cache.h"
+
+std::filesystem::path mesh_cache_file(const std::filesystem::path& mesh_file) {
+    std::filesystem::path path = mesh_file;
+    path += ".meshcache";
+    return path;
+}
+
+void write_mesh_data(BinaryWriter& writer, const MeshData& mesh) {
+    writer.write(mesh.positions);
+    writer.write(mesh.normals);
+    writer.write(mesh.texcoords);
+    writer.write(mesh.indices);
+}
+
+bool read_mesh_data(BinaryReader& reader, MeshData& mesh) {
+    return reader.read(mesh.positions) && reader.read(mesh.normals) &&
+           reader.read(mesh.texcoords) && reader.read(mesh.indices);
+}
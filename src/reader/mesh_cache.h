@@ -0,0 +1,35 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <Eigen/Core>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "../util/BinaryIO.h"
+
+/**
+ * Vertex and index buffers of a mesh read from a file, as passed to
+ * TriangleMesh.
+ */
+struct MeshData {
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<Eigen::Vector2f> texcoords;
+    std::vector<std::array<uint32_t, 3>> indices;
+};
+
+/**
+ * Get the path of the cache file of a mesh file, next to it.
+ */
+std::filesystem::path mesh_cache_file(const std::filesystem::path& mesh_file);
+
+void write_mesh_data(BinaryWriter& writer, const MeshData& mesh);
+
+/**
+ * @return Whether the mesh was read.
+ */
+bool read_mesh_data(BinaryReader& reader, MeshData& mesh);
+
+#endif
@@ -8,11 +8,16 @@
 #define JSON_DIAGNOSTICS 1  // Enable extended diagnostic messages
 #include <json.hpp>
 
+#include "../bvh/build_bvh.h"
+#include "../geometry/Instance.h"
 #include "../geometry/Sphere.h"
-#include "../geometry/Triangle.h"
+#include "../geometry/TriangleMesh.h"
 #include "../light/DirectionalLight.h"
 #include "../light/PointLight.h"
+#include "../util/FileCache.h"
+#include "../util/Timer.h"
 #include "gamma_transform.h"
+#include "mesh_cache.h"
 #include "read_obj.h"
 #include "read_texture.h"
 
@@ -30,12 +35,106 @@ void from_json(const json& j, Vector3f& v) {
 
 namespace {
 
+static BVHOptions parse_bvh_options(const json& j_opts) {
+    BVHOptions options;
+    if (!j_opts.contains("bvh")) return options;
+    const json& j_bvh = j_opts.at("bvh");
+
+    const std::string builder = j_bvh.value("builder", "sah");
+    if (builder == "sah") {
+        options.builder = BVHBuilder::SAH;
+    } else if (builder == "midpoint") {
+        options.builder = BVHBuilder::Midpoint;
+    } else if (builder == "lbvh") {
+        options.builder = BVHBuilder::LBVH;
+    } else {
+        std::cout << "Unknown BVH builder: " << builder << "\n";
+    }
+
+    options.sah_bins = j_bvh.value("sah_bins", options.sah_bins);
+    options.traversal_cost =
+        j_bvh.value("traversal_cost", options.traversal_cost);
+    options.intersection_cost =
+        j_bvh.value("intersection_cost", options.intersection_cost);
+    options.max_leaf_size = j_bvh.value("max_leaf_size", options.max_leaf_size);
+
+    const std::string simd = j_bvh.value("simd", "auto");
+    if (simd == "avx2") {
+        options.simd = SimdLevel::AVX2;
+    } else if (simd == "sse") {
+        options.simd = SimdLevel::SSE;
+    } else if (simd == "scalar") {
+        options.simd = SimdLevel::Scalar;
+    } else if (simd != "auto") {
+        std::cout << "Unknown SIMD level: " << simd << "\n";
+    }
+    if (options.simd > supported_simd_level()) {
+        std::cout << "SIMD level not supported by the CPU: " << simd << "\n";
+        options.simd = supported_simd_level();
+    }
+    return options;
+}
+
+static TileOrder parse_tile_order(const json& j_opts) {
+    const std::string order = j_opts.value("tile_order", "hilbert");
+    if (order == "scanline") return TileOrder::Scanline;
+    if (order == "spiral") return TileOrder::Spiral;
+    if (order != "hilbert") {
+        std::cout << "Unknown tile order: " << order << "\n";
+    }
+    return TileOrder::Hilbert;
+}
+
+static AdaptiveSamplingOptions parse_adaptive_options(const json& j_opts) {
+    AdaptiveSamplingOptions options;
+    if (!j_opts.contains("adaptive")) return options;
+    const json& j_adaptive = j_opts.at("adaptive");
+
+    options.enabled = j_adaptive.value("enabled", true);
+    options.min_samples = j_adaptive.value("min_samples", options.min_samples);
+    options.max_samples = j_adaptive.value("max_samples", options.max_samples);
+    options.threshold = j_adaptive.value("threshold", options.threshold);
+    return options;
+}
+
+static ProgressiveOptions parse_progressive_options(const json& j_opts) {
+    ProgressiveOptions options;
+    if (!j_opts.contains("progressive")) return options;
+    const json& j_progressive = j_opts.at("progressive");
+
+    options.enabled = j_progressive.value("enabled", true);
+    options.time_budget =
+        j_progressive.value("time_budget", options.time_budget);
+    options.preview_interval =
+        j_progressive.value("preview_interval", options.preview_interval);
+    return options;
+}
+
+static LightSampler parse_light_sampler(const json& j_opts) {
+    const std::string sampler = j_opts.value("light_sampler", "bvh");
+    if (sampler == "power") return LightSampler::Power;
+    if (sampler != "bvh") {
+        std::cout << "Unknown light sampler: " << sampler << "\n";
+    }
+    return LightSampler::BVH;
+}
+
 static Options parse_options(const json& j) {
     const json& j_opts = j.at("options");
     return Options{
         .samples = j_opts.at("samples"),
+        .adaptive = parse_adaptive_options(j_opts),
+        .progressive = parse_progressive_options(j_opts),
         .ray_clamp =
             j_opts.value("ray_clamp", std::numeric_limits<float>::infinity()),
+        .max_bounces = j_opts.value("max_bounces", 8U),
+        .russian_roulette_depth = j_opts.value("russian_roulette_depth", 3U),
+        .tile_size = j_opts.value("tile_size", 16U),
+        .tile_order = parse_tile_order(j_opts),
+        .light_sampler = parse_light_sampler(j_opts),
+        .seed = j_opts.value<uint64_t>("seed", 0),
+        .cache = j_opts.value("cache", false),
+        .bvh = parse_bvh_options(j_opts),
     };
 }
 
@@ -149,12 +248,24 @@ parse_materials(const json& j, const std::filesystem::path& base_path) {
     return materials;
 }
 
-static std::vector<std::unique_ptr<Geometry>> read_stl(
-    const json& jobj, const std::shared_ptr<Material>& material,
-    const std::filesystem::path& base_path) {
-    std::ifstream stl_file(base_path / jobj.at("stl"), std::ios::binary);
+struct Vector3fHash {
+    size_t operator()(const Eigen::Vector3f& v) const {
+        size_t seed = 0;
+        for (const float x : v) {
+            seed ^= std::hash<float>()(x) + 0x9e3779b9 + (seed << 6) +
+                    (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+/**
+ * Read the mesh of an .stl file.
+ */
+static MeshData parse_stl(const std::filesystem::path& stl_path) {
+    std::ifstream stl_file(stl_path, std::ios::binary);
     if (!stl_file) {
-        std::cerr << "Error opening STL file: " << jobj.at("stl") << '\n';
+        std::cerr << "Error opening STL file: " << stl_path << '\n';
         exit(EXIT_FAILURE);
     }
 
@@ -163,27 +274,157 @@ static std::vector<std::unique_ptr<Geometry>> read_stl(
     Eigen::MatrixXf N;
     igl::readSTL(stl_file, V, F, N);
 
-    std::vector<std::unique_ptr<Geometry>> objects;
-    objects.reserve(F.rows());
+    // STL stores the vertices of each face separately, so merge the shared
+    // ones. The geometric normals are used, as the normals are per face.
+    MeshData mesh;
+    std::unordered_map<Eigen::Vector3f, uint32_t, Vector3fHash> vertex_indices;
+    mesh.indices.reserve(F.rows());
     for (const auto& f : F.rowwise()) {
-        objects.emplace_back(std::make_unique<Triangle>(
-            std::array<Eigen::Vector3f, 3>{V.row(f[0]), V.row(f[1]),
-                                           V.row(f[2])},
-            std::array<Eigen::Vector3f, 3>{N.row(f[0]), N.row(f[1]),
-                                           N.row(f[2])},
-            std::array<Eigen::Vector2f, 3>{Eigen::Vector2f::Zero(),
-                                           Eigen::Vector2f::Zero(),
-                                           Eigen::Vector2f::Zero()},
-            material));
+        std::array<uint32_t, 3> triangle = {};
+        for (size_t v = 0; v < 3; v++) {
+            const Eigen::Vector3f position = V.row(f[v]);
+            const auto [iter, inserted] = vertex_indices.try_emplace(
+                position, static_cast<uint32_t>(mesh.positions.size()));
+            if (inserted) mesh.positions.push_back(position);
+            triangle.at(v) = iter->second;
+        }
+        mesh.indices.push_back(triangle);
     }
+    return mesh;
+}
 
-    return objects;
+// Version of the cached contents of STL files, to be increased when the way
+// they are read changes.
+static const uint64_t STL_CACHE_KEY = 1;
+
+static std::unique_ptr<Geometry> read_stl(
+    const json& jobj, const std::shared_ptr<Material>& material,
+    const std::filesystem::path& base_path, const bool cache) {
+    const std::filesystem::path stl_path = base_path / jobj.at("stl");
+    const std::filesystem::path cache_file = mesh_cache_file(stl_path);
+
+    MeshData mesh;
+    const bool cached =
+        cache && read_cache(cache_file, STL_CACHE_KEY, [&](BinaryReader& r) {
+            return read_mesh_data(r, mesh);
+        });
+    if (!cached) {
+        mesh = parse_stl(stl_path);
+        if (cache) {
+            write_cache(cache_file, STL_CACHE_KEY, {stl_path},
+                        [&](BinaryWriter& w) { write_mesh_data(w, mesh); });
+        }
+    }
+
+    return std::make_unique<TriangleMesh>(
+        std::move(mesh.positions), std::move(mesh.normals),
+        std::move(mesh.texcoords), std::move(mesh.indices), material);
+}
+
+/**
+ * Parse an object description other than an instance, appending the objects
+ * it describes.
+ */
+static void parse_object(
+    const json& jobj,
+    const std::unordered_map<std::string, std::shared_ptr<Material>>& materials,
+    const std::filesystem::path& base_path, const bool cache,
+    std::vector<std::unique_ptr<Geometry>>& objects) {
+    const std::shared_ptr<Material> material =
+        (jobj.contains("material") && materials.contains(jobj["material"]))
+            ? materials.at(jobj["material"])
+            : nullptr;
+
+    if (jobj.at("type") == "sphere") {
+        objects.emplace_back(std::make_unique<Sphere>(
+            jobj.at("center"), jobj.at("radius"), material));
+
+    } else if (jobj.at("type") == "triangle") {
+        std::vector<Eigen::Vector3f> positions = {jobj.at("corners")[0],
+                                                  jobj.at("corners")[1],
+                                                  jobj.at("corners")[2]};
+        objects.emplace_back(std::make_unique<TriangleMesh>(
+            std::move(positions), std::vector<Eigen::Vector3f>{},
+            std::vector<Eigen::Vector2f>{},
+            std::vector<std::array<uint32_t, 3>>{{0, 1, 2}}, material));
+
+    } else if (jobj.at("type") == "stl") {
+        objects.emplace_back(read_stl(jobj, material, base_path, cache));
+
+    } else if (jobj.at("type") == "obj") {
+        auto obj_objects = read_obj(base_path / jobj.at("obj"), cache);
+        objects.reserve(objects.size() + obj_objects.size());
+        std::ranges::move(obj_objects, std::back_inserter(objects));
+
+    } else {
+        std::cout << "Unknown object type: " << jobj.at("type") << "\n";
+    }
+}
+
+/**
+ * Parse an affine transform, given as the first three or all four rows of a
+ * 4x4 matrix.
+ */
+static Eigen::Affine3f parse_transform(const json& j_transform) {
+    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+    for (Eigen::Index row = 0; row < 3; row++) {
+        for (Eigen::Index col = 0; col < 4; col++) {
+            transform.matrix()(row, col) = j_transform.at(row).at(col);
+        }
+    }
+    if (std::abs(transform.linear().determinant()) < 1e-12F) {
+        std::cerr << "Singular instance transform: " << j_transform << "\n";
+        exit(EXIT_FAILURE);
+    }
+    return transform;
+}
+
+/**
+ * Objects placed by instances, by the dump of their description. Instances
+ * of the same description share the BVH over its objects.
+ */
+using InstancedObjects =
+    std::unordered_map<std::string, std::shared_ptr<const Geometry>>;
+
+static std::unique_ptr<Geometry> parse_instance(
+    const json& jobj,
+    const std::unordered_map<std::string, std::shared_ptr<Material>>& materials,
+    const std::filesystem::path& base_path, const Options& options,
+    InstancedObjects& instanced_objects) {
+    const json& j_object = jobj.at("object");
+    if (j_object.at("type") == "instance") {
+        std::cerr << "Instances cannot place instances.\n";
+        exit(EXIT_FAILURE);
+    }
+
+    const auto [iter, inserted] =
+        instanced_objects.try_emplace(j_object.dump(), nullptr);
+    if (inserted) {
+        std::vector<std::unique_ptr<Geometry>> objects;
+        parse_object(j_object, materials, base_path, options.cache, objects);
+
+        // Each instanced object has its own BVH cache file. Only the
+        // traversals of the scene BVH are counted.
+        BVHOptions bvh_options = options.bvh;
+        bvh_options.collect_stats = false;
+        if (!bvh_options.cache_file.empty()) {
+            bvh_options.cache_file.replace_extension(
+                std::to_string(instanced_objects.size()) + ".bvhcache");
+        }
+        Timer timer("Build instanced BVH");
+        iter->second = build_bvh(std::move(objects), bvh_options);
+    }
+
+    const Eigen::Affine3f transform =
+        jobj.contains("transform") ? parse_transform(jobj.at("transform"))
+                                   : Eigen::Affine3f::Identity();
+    return std::make_unique<Instance>(iter->second, transform);
 }
 
 static std::vector<std::unique_ptr<Geometry>> parse_geometries(
     const json& j,
     const std::unordered_map<std::string, std::shared_ptr<Material>>& materials,
-    const std::filesystem::path& base_path) {
+    const std::filesystem::path& base_path, const Options& options) {
     if (!j.contains("objects")) {
         std::cerr << "No objects found in JSON file.\n";
         exit(EXIT_FAILURE);
@@ -192,42 +433,13 @@ static std::vector<std::unique_ptr<Geometry>> parse_geometries(
 
     std::vector<std::unique_ptr<Geometry>> objects;
     objects.reserve(j_objs.size());
+    InstancedObjects instanced_objects;
     for (const json& jobj : j_objs) {
-        const std::shared_ptr<Material> material =
-            (jobj.contains("material") && materials.contains(jobj["material"]))
-                ? materials.at(jobj["material"])
-                : nullptr;
-
-        if (jobj.at("type") == "sphere") {
-            objects.emplace_back(std::make_unique<Sphere>(
-                jobj.at("center"), jobj.at("radius"), material));
-
-        } else if (jobj.at("type") == "triangle") {
-            const std::array<Eigen::Vector3f, 3> vertices = {
-                jobj.at("corners")[0], jobj.at("corners")[1],
-                jobj.at("corners")[2]};
-            const Eigen::Vector3f normal =
-                ((vertices[1] - vertices[0]).cross(vertices[2] - vertices[0]))
-                    .normalized();
-            objects.emplace_back(std::make_unique<Triangle>(
-                vertices, std::array{normal, normal, normal},
-                std::array<Eigen::Vector2f, 3>{Eigen::Vector2f::Zero(),
-                                               Eigen::Vector2f::Zero(),
-                                               Eigen::Vector2f::Zero()},
-                material));
-
-        } else if (jobj.at("type") == "stl") {
-            auto stl_objects = read_stl(jobj, material, base_path);
-            objects.reserve(objects.size() + stl_objects.size());
-            std::ranges::move(stl_objects, std::back_inserter(objects));
-
-        } else if (jobj.at("type") == "obj") {
-            auto obj_objects = read_obj(base_path / jobj.at("obj"));
-            objects.reserve(objects.size() + obj_objects.size());
-            std::ranges::move(obj_objects, std::back_inserter(objects));
-
+        if (jobj.at("type") == "instance") {
+            objects.emplace_back(parse_instance(jobj, materials, base_path,
+                                                options, instanced_objects));
         } else {
-            std::cout << "Unknown object type: " << jobj.at("type") << "\n";
+            parse_object(jobj, materials, base_path, options.cache, objects);
         }
     }
     return objects;
@@ -235,7 +447,7 @@ static std::vector<std::unique_ptr<Geometry>> parse_geometries(
 
 }  // namespace
 
-Scene read_json(const std::string& filename) {
+Scene read_json(const std::string& filename, const bool bvh_stats) {
     const std::filesystem::path base_path =
         std::filesystem::path(filename).parent_path();
     std::ifstream infile(filename);
@@ -248,9 +460,11 @@ Scene read_json(const std::string& filename) {
     infile >> j;
 
     auto options = parse_options(j);
+    if (options.cache) options.bvh.cache_file = filename + ".bvhcache";
+    options.bvh.collect_stats = bvh_stats;
     auto camera = parse_camera(j);
     auto materials = parse_materials(j, base_path);
-    auto geometries = parse_geometries(j, materials, base_path);
+    auto geometries = parse_geometries(j, materials, base_path, options);
     auto lights = parse_lights(j);
 
     return {options, std::move(camera), std::move(geometries),
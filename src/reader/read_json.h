@@ -9,8 +9,9 @@
  * Read a scene description from a .json file
  *
  * @param filename path to .json file
+ * @param bvh_stats whether the BVH collects traversal statistics
  * @return Scene object representing the scene
  */
-Scene read_json(const std::string& filename);
+Scene read_json(const std::string& filename, bool bvh_stats = false);
 
 #endif
@@ -5,9 +5,14 @@
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include <cassert>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
-#include "../geometry/Triangle.h"
+#include "../geometry/TriangleMesh.h"
+#include "../util/FileCache.h"
+#include "mesh_cache.h"
 #include "read_texture.h"
 
 namespace {
@@ -141,6 +146,37 @@ void compute_smoothing_shape(
     }
 }
 
+struct IndexHash {
+    size_t operator()(const tinyobj::index_t& idx) const {
+        size_t seed = 0;
+        for (const int i :
+             {idx.vertex_index, idx.normal_index, idx.texcoord_index}) {
+            seed ^= std::hash<int>()(i) + 0x9e3779b9 + (seed << 6) +
+                    (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+struct IndexEqual {
+    bool operator()(const tinyobj::index_t& a,
+                    const tinyobj::index_t& b) const {
+        return a.vertex_index == b.vertex_index &&
+               a.normal_index == b.normal_index &&
+               a.texcoord_index == b.texcoord_index;
+    }
+};
+
+/**
+ * Vertex and index buffers of a mesh being read.
+ */
+struct MeshBuilder {
+    MeshData mesh;
+    // Index of the mesh vertex of each distinct face vertex.
+    std::unordered_map<tinyobj::index_t, uint32_t, IndexHash, IndexEqual>
+        vertex_indices;
+};
+
 template <typename T, float gamma>
 static std::unique_ptr<Texture<T>> parse_sampler(
     const std::filesystem::path& base_path, const std::string_view texture) {
@@ -159,10 +195,16 @@ static std::unique_ptr<Sampler<T>> parse_sampler(
                                   std::forward<T>(constant));
 }
 
-}  // namespace
+/**
+ * Contents of an OBJ file: its materials, and one mesh per material, which is
+ * empty if no face uses the material.
+ */
+struct ObjData {
+    std::vector<tinyobj::material_t> materials;
+    std::vector<MeshData> meshes;
+};
 
-std::vector<std::unique_ptr<Geometry>> read_obj(
-    const std::filesystem::path& obj_file) {
+static ObjData parse_obj(const std::filesystem::path& obj_file) {
     const auto compute_smoothing_shapes =
         [&](const tinyobj::attrib_t& attrib,
             const std::vector<tinyobj::shape_t>& shapes)
@@ -223,29 +265,6 @@ std::vector<std::unique_ptr<Geometry>> read_obj(
     auto in_shapes = reader.GetShapes();
     auto in_materials = reader.GetMaterials();
 
-    // Materials
-    const auto base_path = obj_file.parent_path();
-    std::vector<std::shared_ptr<Material>> materials;
-    materials.reserve(in_materials.size());
-    for (auto& material : in_materials) {
-        materials.emplace_back(std::make_shared<Material>(Material{
-            .diffuse = parse_sampler<Eigen::Vector3f, GAMMA_SRGB>(
-                base_path, material.diffuse_texname,
-                to_vector3f(material.diffuse)),
-            .emission = parse_sampler<Eigen::Vector3f, GAMMA_SRGB>(
-                base_path, material.emissive_texname,
-                to_vector3f(material.emission)),
-            .roughness = parse_sampler<float, GAMMA_LINEAR>(
-                base_path, material.roughness_texname, material.roughness),
-            .metallic = parse_sampler<float, GAMMA_LINEAR>(
-                base_path, material.metallic_texname, material.metallic),
-            .normal = parse_sampler<Eigen::Vector3f, GAMMA_LINEAR>(
-                base_path, material.normal_texname),
-            .emissive = material.emissive_texname != "" ||
-                        to_vector3f(material.emission).any(),
-        }));
-    }
-
     if (in_attrib.normals.empty()) {
         auto smoothed = compute_smoothing_shapes(in_attrib, in_shapes);
         in_shapes = std::get<0>(smoothed);
@@ -253,20 +272,20 @@ std::vector<std::unique_ptr<Geometry>> read_obj(
         compute_all_smoothing_normals(in_attrib, in_shapes);
     }
 
-    std::vector<std::unique_ptr<Geometry>> objects;
+    // One mesh per material. Face vertices with the same position, normal
+    // and texture coordinates indices share a mesh vertex.
+    std::vector<MeshBuilder> builders(in_materials.size());
+    const bool has_texcoords = !in_attrib.texcoords.empty();
 
     for (const auto& shape : in_shapes) {
-        objects.reserve(objects.size() + shape.mesh.num_face_vertices.size());
-
         // For each face
         size_t index_offset = 0;
         for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
             const size_t fv = shape.mesh.num_face_vertices[f];
             assert(fv == 3);
 
-            std::array<Eigen::Vector3f, 3> vertices = {};
-            std::array<Eigen::Vector3f, 3> normals = {};
-            std::array<Eigen::Vector2f, 3> texcoords = {};
+            MeshBuilder& builder = builders[shape.mesh.material_ids[f]];
+            std::array<uint32_t, 3> triangle = {};
 
             // Loop over vertices in the face.
             for (size_t v = 0; v < fv; v++) {
@@ -274,32 +293,171 @@ std::vector<std::unique_ptr<Geometry>> read_obj(
                 const tinyobj::index_t& idx =
                     shape.mesh.indices[index_offset + v];
 
-                vertices.at(v) = Eigen::Vector3f(
+                const auto [iter, inserted] =
+                    builder.vertex_indices.try_emplace(
+                        idx,
+                        static_cast<uint32_t>(builder.mesh.positions.size()));
+                triangle.at(v) = iter->second;
+                if (!inserted) continue;
+
+                builder.mesh.positions.emplace_back(
                     in_attrib.vertices[3 * idx.vertex_index + 0],
                     in_attrib.vertices[3 * idx.vertex_index + 1],
                     in_attrib.vertices[3 * idx.vertex_index + 2]);
 
-                normals.at(v) = Eigen::Vector3f(
+                builder.mesh.normals.emplace_back(
                     in_attrib.normals[3 * idx.normal_index + 0],
                     in_attrib.normals[3 * idx.normal_index + 1],
                     in_attrib.normals[3 * idx.normal_index + 2]);
 
+                if (!has_texcoords) continue;
                 if (idx.texcoord_index != -1) {
-                    texcoords.at(v) = Eigen::Vector2f(
+                    builder.mesh.texcoords.emplace_back(
                         in_attrib.texcoords[2 * idx.texcoord_index + 0],
                         in_attrib.texcoords[2 * idx.texcoord_index + 1]);
                 } else {
-                    texcoords.at(v) = Eigen::Vector2f::Zero();
+                    builder.mesh.texcoords.emplace_back(
+                        Eigen::Vector2f::Zero());
                 }
             }
 
-            const auto& material = materials[shape.mesh.material_ids[f]];
-
-            objects.emplace_back(std::make_unique<Triangle>(
-                vertices, normals, texcoords, material));
+            builder.mesh.indices.push_back(triangle);
 
             index_offset += fv;
         }
     }
+
+    ObjData data = {.materials = std::move(in_materials), .meshes = {}};
+    data.meshes.reserve(builders.size());
+    for (MeshBuilder& builder : builders) {
+        data.meshes.push_back(std::move(builder.mesh));
+    }
+    return data;
+}
+
+/**
+ * Get the material libraries referenced by the `mtllib` statements of an OBJ
+ * file, resolved as by tinyobjloader.
+ */
+static std::vector<std::filesystem::path> material_libraries(
+    const std::filesystem::path& obj_file) {
+    std::vector<std::filesystem::path> libraries;
+    std::ifstream stream(obj_file);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword) || keyword != "mtllib") continue;
+        std::string library;
+        while (tokens >> library) {
+            libraries.push_back(obj_file.parent_path() / library);
+        }
+    }
+    return libraries;
+}
+
+// Version of the cached contents of OBJ files, to be increased when the way
+// they are read changes.
+static const uint64_t OBJ_CACHE_KEY = 1;
+
+// Only the material parameters used by the renderer are cached.
+
+static void write_material(BinaryWriter& writer,
+                           const tinyobj::material_t& material) {
+    writer.write(material.diffuse);
+    writer.write(material.emission);
+    writer.write(material.roughness);
+    writer.write(material.metallic);
+    writer.write(material.diffuse_texname);
+    writer.write(material.emissive_texname);
+    writer.write(material.roughness_texname);
+    writer.write(material.metallic_texname);
+    writer.write(material.normal_texname);
+}
+
+static bool read_material(BinaryReader& reader,
+                          tinyobj::material_t& material) {
+    return reader.read(material.diffuse) && reader.read(material.emission) &&
+           reader.read(material.roughness) && reader.read(material.metallic) &&
+           reader.read(material.diffuse_texname) &&
+           reader.read(material.emissive_texname) &&
+           reader.read(material.roughness_texname) &&
+           reader.read(material.metallic_texname) &&
+           reader.read(material.normal_texname);
+}
+
+static void write_obj_data(BinaryWriter& writer, const ObjData& data) {
+    writer.write(static_cast<uint64_t>(data.materials.size()));
+    for (size_t i = 0; i < data.materials.size(); i++) {
+        write_material(writer, data.materials[i]);
+        write_mesh_data(writer, data.meshes[i]);
+    }
+}
+
+static bool read_obj_data(BinaryReader& reader, ObjData& data) {
+    uint64_t num_materials = 0;
+    if (!reader.read(num_materials)) return false;
+    data.materials.clear();
+    data.meshes.clear();
+    for (uint64_t i = 0; i < num_materials; i++) {
+        if (!read_material(reader, data.materials.emplace_back()) ||
+            !read_mesh_data(reader, data.meshes.emplace_back())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<std::unique_ptr<Geometry>> read_obj(
+    const std::filesystem::path& obj_file, const bool cache) {
+    ObjData data;
+    const std::filesystem::path cache_file = mesh_cache_file(obj_file);
+    const bool cached =
+        cache && read_cache(cache_file, OBJ_CACHE_KEY, [&](BinaryReader& r) {
+            return read_obj_data(r, data);
+        });
+    if (!cached) {
+        data = parse_obj(obj_file);
+        if (cache) {
+            std::vector<std::filesystem::path> sources =
+                material_libraries(obj_file);
+            sources.push_back(obj_file);
+            write_cache(cache_file, OBJ_CACHE_KEY, sources,
+                        [&](BinaryWriter& w) { write_obj_data(w, data); });
+        }
+    }
+
+    // The materials are made from their cached parameters, as the textures
+    // are not cached.
+    const auto base_path = obj_file.parent_path();
+    std::vector<std::unique_ptr<Geometry>> objects;
+    for (size_t i = 0; i < data.materials.size(); i++) {
+        tinyobj::material_t& material = data.materials[i];
+        MeshData& mesh = data.meshes[i];
+        if (mesh.indices.empty()) continue;
+
+        auto mesh_material = std::make_shared<Material>(Material{
+            .diffuse = parse_sampler<Eigen::Vector3f, GAMMA_SRGB>(
+                base_path, material.diffuse_texname,
+                to_vector3f(material.diffuse)),
+            .emission = parse_sampler<Eigen::Vector3f, GAMMA_SRGB>(
+                base_path, material.emissive_texname,
+                to_vector3f(material.emission)),
+            .roughness = parse_sampler<float, GAMMA_LINEAR>(
+                base_path, material.roughness_texname, material.roughness),
+            .metallic = parse_sampler<float, GAMMA_LINEAR>(
+                base_path, material.metallic_texname, material.metallic),
+            .normal = parse_sampler<Eigen::Vector3f, GAMMA_LINEAR>(
+                base_path, material.normal_texname),
+            .emissive = material.emissive_texname != "" ||
+                        to_vector3f(material.emission).any(),
+        });
+        objects.emplace_back(std::make_unique<TriangleMesh>(
+            std::move(mesh.positions), std::move(mesh.normals),
+            std::move(mesh.texcoords), std::move(mesh.indices),
+            std::move(mesh_material)));
+    }
     return objects;
 }
@@ -7,7 +7,16 @@
 
 #include "../geometry/Geometry.h"
 
+/**
+ * Read the meshes of an .obj file, one per material.
+ *
+ * @param obj_file Path to the .obj file.
+ * @param cache Whether the meshes and material parameters are cached in a
+ * .meshcache file next to the .obj file, and read from it while neither the
+ * .obj file nor its material libraries change.
+ * @return The meshes.
+ */
 std::vector<std::unique_ptr<Geometry>> read_obj(
-    const std::filesystem::path& obj_file);
+    const std::filesystem::path& obj_file, bool cache);
 
 #endif
@@ -2,36 +2,308 @@
 
 #include <omp.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <optional>
+#include <string>
 
 #include "path_tracing.h"
 #include "util/ProgressBar.h"
+#include "util/TileScheduler.h"
 #include "util/Timer.h"
+#include "util/color.h"
 
-std::vector<Eigen::Vector3f> render(const Scene& scene) {
+namespace {
+
+// Lower bound of the luminance in the relative error of a pixel, so that
+// nearly black pixels can converge.
+static const float MIN_LUMINANCE = 1e-3F;
+
+// Maximum number of samples of a pixel relative to the average, when the
+// adaptive sampling options leave it unset.
+static const unsigned int DEFAULT_MAX_SAMPLES_FACTOR = 4;
+
+// Accumulated samples of a pixel.
+struct PixelState {
+    Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+    unsigned int num_samples = 0;
+    // Running mean and sum of squared deviations of the luminance
+    // (Welford's algorithm)
+    float mean = 0.F;
+    float m2 = 0.F;
+    // Whether adaptive sampling has stopped the pixel.
+    bool converged = false;
+};
+
+/**
+ * Add samples to a pixel until it has `end_samples` samples. With adaptive
+ * sampling, the pixel stops early once the relative standard error of the
+ * mean luminance falls below the threshold.
+ *
+ * @return The number of samples taken.
+ */
+static unsigned int render_pixel(const Scene& scene, const unsigned int i,
+                                 const unsigned int j,
+                                 const unsigned int end_samples,
+                                 PixelState& pixel) {
+    const AdaptiveSamplingOptions& adaptive = scene.options.adaptive;
+
+    const unsigned int begin_samples = pixel.num_samples;
+    while (!pixel.converged && pixel.num_samples < end_samples) {
+        // Each sample owns a generator determined by the seed, the pixel and
+        // the sample index, independently of the threads and the passes. The
+        // seed is hashed before the sample index is combined with it, so that
+        // renders with neighbouring seeds share no samples.
+        Random rng(Random::hash(Random::hash(scene.options.seed) ^
+                                pixel.num_samples),
+                   static_cast<uint64_t>(i) * scene.camera.resolution_x + j);
+        Ray ray = scene.camera.viewing_ray(i, j, rng);
+        const Eigen::Vector3f rgb = sample(ray, scene, rng);
+        pixel.sum += rgb;
+        const unsigned int n = ++pixel.num_samples;
+
+        if (!adaptive.enabled) continue;
+
+        const float y = luminance(rgb);
+        const float delta = y - pixel.mean;
+        pixel.mean += delta / static_cast<float>(n);
+        pixel.m2 += delta * (y - pixel.mean);
+
+        if (n >= std::max(adaptive.min_samples, 2U)) {
+            const auto n_f = static_cast<float>(n);
+            const float std_error = std::sqrt(pixel.m2 / ((n_f - 1) * n_f));
+            pixel.converged =
+                std_error <=
+                adaptive.threshold * std::max(pixel.mean, MIN_LUMINANCE);
+        }
+    }
+    return pixel.num_samples - begin_samples;
+}
+
+/**
+ * Render a full-frame pass, bringing every pixel to `end_samples` samples.
+ *
+ * @return The number of samples taken.
+ */
+static uint64_t render_pass(const Scene& scene, std::vector<PixelState>& pixels,
+                            const unsigned int end_samples,
+                            const std::string& name) {
     const unsigned int width = scene.camera.resolution_x;
     const unsigned int height = scene.camera.resolution_y;
-    std::vector<Eigen::Vector3f> image(static_cast<size_t>(width * height),
-                                       Eigen::Vector3f::Zero());
+    const auto num_threads = static_cast<unsigned int>(omp_get_max_threads());
 
-    std::cout << "Rendering in threads: " << omp_get_max_threads() << '\n';
-    Timer timer("Render");
-    ProgressBar progress_bar("Rendering", static_cast<int>(width * height));
-
-#pragma omp parallel for collapse(2) schedule(dynamic)
-    for (unsigned int i = 0; i < height; i++) {
-        for (unsigned int j = 0; j < width; j++) {
-            for (unsigned int s = 0; s < scene.options.samples; s++) {
-                Ray ray = scene.camera.viewing_ray(i, j);
-                Eigen::Vector3f rgb = sample(ray, scene);
-                image[i * width + j] += rgb;
+    TileScheduler scheduler(width, height, scene.options.tile_size,
+                            scene.options.tile_order, num_threads);
+    ProgressBar progress_bar(name, static_cast<int>(scheduler.size()));
+    uint64_t total_samples = 0;
+
+#pragma omp parallel
+    {
+        const auto thread = static_cast<unsigned int>(omp_get_thread_num());
+        while (const std::optional<Tile> tile = scheduler.next(thread)) {
+            uint64_t tile_samples = 0;
+            for (unsigned int i = tile->y_begin; i < tile->y_end; i++) {
+                for (unsigned int j = tile->x_begin; j < tile->x_end; j++) {
+                    tile_samples += render_pixel(scene, i, j, end_samples,
+                                                 pixels[i * width + j]);
+                }
             }
-            image[i * width + j] /= static_cast<float>(scene.options.samples);
-            image[i * width + j] *= scene.camera.exposure;
+
+#pragma omp atomic update
+            total_samples += tile_samples;
 
             progress_bar.update();
         }
     }
 
+    return total_samples;
+}
+
+/**
+ * Get the number of samples per pixel that the pixels still sampling can
+ * reach. With adaptive sampling, the budget of `samples` samples per pixel
+ * on average left by the stopped pixels is shared among the others, up to
+ * the maximum number of samples. The pixels still sampling all have
+ * `samples` samples, the number reached by the last pass.
+ *
+ * @param samples Number of samples per pixel reached by the last pass.
+ * @param total_samples Number of samples taken over all pixels.
+ */
+static unsigned int sample_target(const Scene& scene,
+                                  const std::vector<PixelState>& pixels,
+                                  const unsigned int samples,
+                                  const uint64_t total_samples) {
+    const AdaptiveSamplingOptions& adaptive = scene.options.adaptive;
+    if (!adaptive.enabled) return scene.options.samples;
+
+    const auto num_sampling = static_cast<uint64_t>(
+        std::ranges::count(pixels, false, &PixelState::converged));
+    if (num_sampling == 0) return samples;
+
+    const uint64_t budget =
+        static_cast<uint64_t>(scene.options.samples) * pixels.size();
+    if (total_samples >= budget) return samples;
+    const unsigned int max_samples =
+        adaptive.max_samples > 0
+            ? adaptive.max_samples
+            : DEFAULT_MAX_SAMPLES_FACTOR * scene.options.samples;
+    return static_cast<unsigned int>(
+        std::min<uint64_t>(samples + (budget - total_samples) / num_sampling,
+                           std::max(max_samples, samples)));
+}
+
+/**
+ * Render in full-frame passes until the pixels reach the target number of
+ * samples. The first pass brings every pixel to `samples` samples, and the
+ * following ones spend the samples left by the pixels stopped by adaptive
+ * sampling.
+ *
+ * @return The number of samples taken.
+ */
+static uint64_t render_full(const Scene& scene,
+                            std::vector<PixelState>& pixels) {
+    uint64_t total_samples = 0;
+    unsigned int samples = 0;
+    unsigned int target = 0;
+    while ((target = sample_target(scene, pixels, samples, total_samples)) >
+           samples) {
+        total_samples += render_pass(
+            scene, pixels, target,
+            samples == 0 ? "Rendering"
+                         : "Redistributing (" + std::to_string(target) +
+                               " spp)");
+        samples = target;
+    }
+    return total_samples;
+}
+
+/**
+ * Average the accumulated samples of each pixel into an image.
+ */
+static std::vector<Eigen::Vector3f> resolve(
+    const Scene& scene, const std::vector<PixelState>& pixels) {
+    std::vector<Eigen::Vector3f> image(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++) {
+        const PixelState& pixel = pixels[i];
+        image[i] = pixel.num_samples > 0
+                       ? Eigen::Vector3f(
+                             pixel.sum / static_cast<float>(pixel.num_samples))
+                       : Eigen::Vector3f::Zero();
+        image[i] *= scene.camera.exposure;
+    }
     return image;
 }
+
+/**
+ * Render in full-frame passes, each doubling the number of samples per pixel,
+ * until the target number of samples (see `sample_target`) or the time budget
+ * is reached. The samples of a pass are limited to what is expected to fit in
+ * the remaining budget and before the next preview is due, extrapolated from
+ * the time taken by the previous passes.
+ *
+ * @return The number of samples taken.
+ */
+static uint64_t render_progressive(const Scene& scene,
+                                   std::vector<PixelState>& pixels,
+                                   const ImageCallback& on_preview) {
+    using Clock = std::chrono::steady_clock;
+    const ProgressiveOptions& progressive = scene.options.progressive;
+
+    const auto start = Clock::now();
+    auto last_preview = start;
+    const auto seconds_since = [](const Clock::time_point time) {
+        return std::chrono::duration<double>(Clock::now() - time).count();
+    };
+
+    uint64_t total_samples = 0;
+    unsigned int samples = 0;
+    unsigned int pass = 0;
+    unsigned int target_samples = 0;
+    while ((target_samples = sample_target(scene, pixels, samples,
+                                           total_samples)) > samples) {
+        unsigned int end_samples =
+            samples + std::min(std::max(samples, 1U), target_samples - samples);
+        // Whether the pass ends when the next preview is due.
+        bool preview_due = false;
+
+        if (samples > 0) {
+            // Time for one more sample in each pixel still sampling.
+            const double elapsed = seconds_since(start);
+            const auto num_sampling = static_cast<double>(
+                std::ranges::count(pixels, false, &PixelState::converged));
+            const double seconds_per_sample =
+                elapsed * num_sampling / static_cast<double>(total_samples);
+            // Limit the pass to the samples expected to fit in a duration,
+            // with at least one sample.
+            const auto limit_samples = [&](const double seconds) {
+                const double affordable =
+                    std::max(seconds / seconds_per_sample, 1.);
+                if (affordable >= end_samples - samples) return false;
+                end_samples = samples + static_cast<unsigned int>(affordable);
+                return true;
+            };
+
+            if (progressive.time_budget > 0) {
+                const double remaining = progressive.time_budget - elapsed;
+                if (remaining < seconds_per_sample) break;
+                limit_samples(remaining);
+            }
+            if (on_preview && progressive.preview_interval > 0) {
+                preview_due = limit_samples(progressive.preview_interval -
+                                            seconds_since(last_preview));
+            }
+        }
+
+        pass++;
+        total_samples += render_pass(
+            scene, pixels, end_samples,
+            "Pass " + std::to_string(pass) + " (" +
+                std::to_string(end_samples) + " spp)");
+        samples = end_samples;
+
+        if (progressive.time_budget > 0 &&
+            seconds_since(start) >= progressive.time_budget) {
+            break;
+        }
+
+        if (on_preview && progressive.preview_interval > 0 &&
+            sample_target(scene, pixels, samples, total_samples) > samples &&
+            (preview_due ||
+             seconds_since(last_preview) >= progressive.preview_interval)) {
+            on_preview(resolve(scene, pixels));
+            last_preview = Clock::now();
+        }
+    }
+
+    std::cout << "Samples per pixel: " << samples << " in " << pass
+              << " passes\n";
+    return total_samples;
+}
+
+}  // namespace
+
+std::vector<Eigen::Vector3f> render(const Scene& scene,
+                                    const ImageCallback& on_preview) {
+    const unsigned int width = scene.camera.resolution_x;
+    const unsigned int height = scene.camera.resolution_y;
+    std::vector<PixelState> pixels(static_cast<size_t>(width) * height);
+
+    std::cout << "Rendering in threads: " << omp_get_max_threads() << '\n';
+    Timer timer("Render");
+
+    const uint64_t total_samples =
+        scene.options.progressive.enabled
+            ? render_progressive(scene, pixels, on_preview)
+            : render_full(scene, pixels);
+
+    if (scene.options.adaptive.enabled) {
+        std::cout << "Average samples per pixel: "
+                  << static_cast<double>(total_samples) /
+                         static_cast<double>(pixels.size())
+                  << '\n';
+    }
+
+    return resolve(scene, pixels);
+}
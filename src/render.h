@@ -2,9 +2,21 @@
 #define RENDER_H
 
 #include <Eigen/Core>
+#include <functional>
+#include <vector>
 
 #include "Scene.h"
 
-std::vector<Eigen::Vector3f> render(const Scene& scene);
+using ImageCallback = std::function<void(const std::vector<Eigen::Vector3f>&)>;
+
+/**
+ * Render the scene into a row-major image of linear colors.
+ *
+ * @param scene The scene to render.
+ * @param on_preview Called with the intermediate images in progressive mode.
+ * @return The rendered image.
+ */
+std::vector<Eigen::Vector3f> render(const Scene& scene,
+                                    const ImageCallback& on_preview = {});
 
 #endif
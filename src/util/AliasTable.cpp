@@ -0,0 +1,51 @@
+#include "AliasTable.h"
+
+#include <cmath>
+#include <numeric>
+
+AliasTable::AliasTable(const std::vector<float>& weights)
+    : bins(weights.size()), pmfs(weights.size()) {
+    if (weights.empty()) return;
+    const size_t n = weights.size();
+
+    // Accumulate in double so that many tiny weights are not lost.
+    const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    for (size_t i = 0; i < n; i++) {
+        pmfs[i] = sum > 0 && std::isfinite(sum)
+                      ? static_cast<float>(weights[i] / sum)
+                      : 1.F / static_cast<float>(n);
+    }
+
+    // Scale the probabilities so that the average bin holds 1, and pair each
+    // underfull bin with an overfull one that fills the rest of it.
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; i++) {
+        scaled[i] = static_cast<double>(pmfs[i]) * static_cast<double>(n);
+        (scaled[i] < 1 ? small : large).emplace_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+
+        bins[s] = {static_cast<float>(scaled[s]), l};
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1) {
+            large.pop_back();
+            small.emplace_back(l);
+        }
+    }
+
+    // Whatever remains is full up to rounding errors.
+    for (const uint32_t i : small) bins[i] = {1.F, i};
+    for (const uint32_t i : large) bins[i] = {1.F, i};
+}
+
+uint32_t AliasTable::sample(Random& rng) const {
+    const uint32_t index = rng.uniform_int(size());
+    const Bin& bin = bins[index];
+    return rng.uniform() < bin.probability ? index : bin.alias;
+}
@@ -0,0 +1,56 @@
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "random.h"
+
+/**
+ * Discrete distribution over indices, sampled in constant time with Vose's
+ * alias method.
+ *
+ * Reference:
+ * https://www.keithschwarz.com/darts-dice-coins/
+ */
+class AliasTable {
+   public:
+    AliasTable() = default;
+
+    /**
+     * Build the table.
+     *
+     * @param weights Non-negative weight of each index. The indices are
+     * sampled uniformly if all the weights are zero.
+     */
+    explicit AliasTable(const std::vector<float>& weights);
+
+    /**
+     * Sample an index with probability proportional to its weight.
+     *
+     * @param [in,out] rng Random number generator.
+     * @return Sampled index. The table must not be empty.
+     */
+    [[nodiscard]] uint32_t sample(Random& rng) const;
+
+    /**
+     * Get the probability of sampling an index.
+     */
+    [[nodiscard]] float pmf(const uint32_t index) const { return pmfs[index]; }
+
+    [[nodiscard]] uint32_t size() const {
+        return static_cast<uint32_t>(bins.size());
+    }
+
+   private:
+    struct Bin {
+        // Probability of keeping the index of the bin rather than its alias.
+        float probability;
+        uint32_t alias;
+    };
+
+    std::vector<Bin> bins;
+    std::vector<float> pmfs;
+};
+
+#endif
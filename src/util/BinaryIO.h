@@ -0,0 +1,96 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Writes plain values, vectors of plain values and strings to a binary
+ * stream, in the memory layout of the machine. Plain values are copied
+ * bytewise, so they must not hold pointers.
+ */
+class BinaryWriter {
+   public:
+    explicit BinaryWriter(std::ostream& stream) : stream(stream) {}
+
+    template <typename T>
+    void write(const T& value) {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Write the number of elements, followed by the elements.
+     */
+    template <typename T>
+    void write(const std::vector<T>& values) {
+        write(static_cast<uint64_t>(values.size()));
+        stream.write(reinterpret_cast<const char*>(values.data()),
+                     static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    /**
+     * Write the length of the string, followed by its characters.
+     */
+    void write(const std::string& value) {
+        write(static_cast<uint64_t>(value.size()));
+        stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+   private:
+    std::ostream& stream;
+};
+
+/**
+ * Reads the values written by BinaryWriter from memory. Every read checks the
+ * remaining size, and fails without changing the value if it is too short.
+ */
+class BinaryReader {
+   public:
+    BinaryReader(const std::byte* data, size_t size)
+        : data(data), remaining(size) {}
+
+    template <typename T>
+    [[nodiscard]] bool read(T& value) {
+        if (remaining < sizeof(T)) return false;
+        std::memcpy(static_cast<void*>(&value), data, sizeof(T));
+        advance(sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    [[nodiscard]] bool read(std::vector<T>& values) {
+        uint64_t size = 0;
+        if (!read(size) || remaining / sizeof(T) < size) return false;
+        values.resize(size);
+        // memcpy() must not be given the null data of an empty vector.
+        if (size == 0) return true;
+        std::memcpy(static_cast<void*>(values.data()), data, size * sizeof(T));
+        advance(size * sizeof(T));
+        return true;
+    }
+
+    [[nodiscard]] bool read(std::string& value) {
+        uint64_t size = 0;
+        if (!read(size) || remaining < size) return false;
+        value.assign(reinterpret_cast<const char*>(data), size);
+        advance(size);
+        return true;
+    }
+
+    [[nodiscard]] bool at_end() const { return remaining == 0; }
+
+   private:
+    void advance(const size_t size) {
+        data += size;
+        remaining -= size;
+    }
+
+    const std::byte* data;
+    size_t remaining;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "FileCache.h"
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "MappedFile.h"
+#include "hash.h"
+
+namespace {
+
+static const std::array<char, 8> MAGIC = {'P', 'T', 'C', 'A', 'C', 'H', 'E', 0};
+// Version of the layout of the cache files, to be increased when it changes.
+static const uint32_t VERSION = 1;
+
+// Hash recorded for a source file that does not exist.
+static const uint64_t MISSING_FILE_HASH = 0;
+
+static uint64_t source_hash(const std::filesystem::path& path) {
+    return hash_file(path).value_or(MISSING_FILE_HASH);
+}
+
+}  // namespace
+
+bool read_cache(const std::filesystem::path& path, const uint64_t key,
+                const std::function<bool(BinaryReader&)>& read) {
+    const MappedFile file(path);
+    if (!file.is_open()) return false;
+    BinaryReader reader(file.data(), file.size());
+
+    std::array<char, 8> magic = {};
+    uint32_t version = 0;
+    uint64_t file_key = 0;
+    if (!reader.read(magic) || magic != MAGIC || !reader.read(version) ||
+        version != VERSION || !reader.read(file_key) || file_key != key) {
+        return false;
+    }
+
+    uint64_t num_sources = 0;
+    if (!reader.read(num_sources)) return false;
+    for (uint64_t i = 0; i < num_sources; i++) {
+        std::string source;
+        uint64_t hash = 0;
+        if (!reader.read(source) || !reader.read(hash) ||
+            source_hash(source) != hash) {
+            return false;
+        }
+    }
+
+    if (!read(reader) || !reader.at_end()) return false;
+    std::cout << "Read cache file: " << path.string() << "\n";
+    return true;
+}
+
+void write_cache(const std::filesystem::path& path, const uint64_t key,
+                 const std::vector<std::filesystem::path>& sources,
+                 const std::function<void(BinaryWriter&)>& write) {
+    // The contents are written to a temporary file which then replaces the
+    // cache file, so that a partially written cache is never read.
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream stream(temporary_path, std::ios::binary);
+        BinaryWriter writer(stream);
+        writer.write(MAGIC);
+        writer.write(VERSION);
+        writer.write(key);
+        writer.write(static_cast<uint64_t>(sources.size()));
+        for (const std::filesystem::path& source : sources) {
+            writer.write(std::filesystem::absolute(source).string());
+            writer.write(source_hash(source));
+        }
+        write(writer);
+
+        if (!stream) {
+            std::cout << "Cannot write cache file: " << path.string() << "\n";
+            std::error_code error;
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::cout << "Cannot write cache file: " << path.string() << "\n";
+        return;
+    }
+    std::cout << "Wrote cache file: " << path.string() << "\n";
+}
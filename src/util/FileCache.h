@@ -0,0 +1,42 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#include "BinaryIO.h"
+
+/**
+ * Read a cache file, if it was written with the same key and none of the
+ * source files it was made from changed since. The file is memory-mapped
+ * while it is read.
+ *
+ * @param path Path of the cache file.
+ * @param key Hash of the settings and data the contents depend on, other than
+ * the source files.
+ * @param read Callable reading the contents, returning false if they are
+ * malformed.
+ * @return Whether the contents were read.
+ */
+bool read_cache(const std::filesystem::path& path, uint64_t key,
+                const std::function<bool(BinaryReader&)>& read);
+
+/**
+ * Write a cache file, along with the hashes of the source files its contents
+ * are made from. Failures are reported but not fatal, since the contents can
+ * be made again.
+ *
+ * @param path Path of the cache file.
+ * @param key Hash of the settings and data the contents depend on, other than
+ * the source files.
+ * @param sources Files the contents are made from. Files that do not exist are
+ * recorded as missing, so that creating them invalidates the cache.
+ * @param write Callable writing the contents.
+ */
+void write_cache(const std::filesystem::path& path, uint64_t key,
+                 const std::vector<std::filesystem::path>& sources,
+                 const std::function<void(BinaryWriter&)>& write);
+
+#endif
@@ -0,0 +1,64 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return;
+
+    buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size()))) {
+        return;
+    }
+
+    open = true;
+    bytes = buffer.data();
+    length = buffer.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return;
+
+    struct stat status = {};
+    if (fstat(fd, &status) == 0) {
+        const auto size = static_cast<size_t>(status.st_size);
+        if (size == 0) {
+            // Empty files cannot be mapped.
+            open = true;
+        } else {
+            void* const address =
+                mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                open = true;
+                bytes = static_cast<const std::byte*>(address);
+                length = size;
+            }
+        }
+    }
+    // The mapping stays valid after the file is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (bytes != nullptr) {
+        munmap(const_cast<std::byte*>(bytes), length);
+    }
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+/**
+ * A file mapped read-only into memory for the lifetime of the object. Where
+ * memory mapping is not available, the file is read into memory instead.
+ */
+class MappedFile {
+   public:
+    /**
+     * Map a file. Check `is_open()` for errors.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] bool is_open() const { return open; }
+    [[nodiscard]] const std::byte* data() const { return bytes; }
+    [[nodiscard]] size_t size() const { return length; }
+
+   private:
+    bool open = false;
+    const std::byte* bytes = nullptr;
+    size_t length = 0;
+    // Contents of the file where it is read instead of mapped.
+    std::vector<std::byte> buffer;
+};
+
+#endif
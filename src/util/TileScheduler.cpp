@@ -0,0 +1,128 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+/**
+ * Compute the index of a cell along a Hilbert curve covering an n x n grid,
+ * where n is a power of 2.
+ *
+ * Reference:
+ * https://en.wikipedia.org/wiki/Hilbert_curve
+ */
+static uint64_t hilbert_index(const uint32_t n, uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        const uint32_t rx = (x & s) > 0 ? 1 : 0;
+        const uint32_t ry = (y & s) > 0 ? 1 : 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+}  // namespace
+
+TileScheduler::TileScheduler(const unsigned int width,
+                             const unsigned int height,
+                             const unsigned int tile_size,
+                             const TileOrder order,
+                             const unsigned int num_threads) {
+    const unsigned int size = std::max(tile_size, 1U);
+    const unsigned int num_x = (width + size - 1) / size;
+    const unsigned int num_y = (height + size - 1) / size;
+
+    struct Cell {
+        unsigned int x;
+        unsigned int y;
+    };
+    std::vector<Cell> cells;
+    cells.reserve(static_cast<size_t>(num_x) * num_y);
+    for (unsigned int y = 0; y < num_y; y++) {
+        for (unsigned int x = 0; x < num_x; x++) {
+            cells.push_back({x, y});
+        }
+    }
+
+    if (order == TileOrder::Spiral) {
+        // Sort by the square ring around the center, then by the angle within
+        // the ring.
+        const float center_x = static_cast<float>(num_x - 1) / 2;
+        const float center_y = static_cast<float>(num_y - 1) / 2;
+        const auto ring = [&](const Cell& c) {
+            return std::max(std::abs(static_cast<float>(c.x) - center_x),
+                            std::abs(static_cast<float>(c.y) - center_y));
+        };
+        const auto angle = [&](const Cell& c) {
+            return std::atan2(static_cast<float>(c.y) - center_y,
+                              static_cast<float>(c.x) - center_x);
+        };
+        std::ranges::stable_sort(cells, [&](const Cell& a, const Cell& b) {
+            const float ring_a = ring(a);
+            const float ring_b = ring(b);
+            if (ring_a != ring_b) return ring_a < ring_b;
+            return angle(a) < angle(b);
+        });
+
+    } else if (order == TileOrder::Hilbert) {
+        uint32_t n = 1;
+        while (n < std::max(num_x, num_y)) n *= 2;
+        std::ranges::stable_sort(cells, [n](const Cell& a, const Cell& b) {
+            return hilbert_index(n, a.x, a.y) < hilbert_index(n, b.x, b.y);
+        });
+    }
+
+    // Deal the tiles in order, so that every thread starts with the first
+    // tiles of the order.
+    num_tiles = cells.size();
+    queues.resize(std::max(num_threads, 1U));
+    for (auto& queue : queues) {
+        queue = std::make_unique<Queue>();
+    }
+    for (size_t i = 0; i < cells.size(); i++) {
+        const Cell& c = cells[i];
+        queues[i % queues.size()]->tiles.push_back({
+            .x_begin = c.x * size,
+            .y_begin = c.y * size,
+            .x_end = std::min((c.x + 1) * size, width),
+            .y_end = std::min((c.y + 1) * size, height),
+        });
+    }
+}
+
+std::optional<Tile> TileScheduler::next(const unsigned int thread) {
+    // Take from the front of the own queue
+    {
+        Queue& queue = *queues[thread % queues.size()];
+        const std::scoped_lock lock(queue.mutex);
+        if (!queue.tiles.empty()) {
+            const Tile tile = queue.tiles.front();
+            queue.tiles.pop_front();
+            return tile;
+        }
+    }
+
+    // Steal from the back of the queue of another thread
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& queue = *queues[(thread + i) % queues.size()];
+        const std::scoped_lock lock(queue.mutex);
+        if (!queue.tiles.empty()) {
+            const Tile tile = queue.tiles.back();
+            queue.tiles.pop_back();
+            return tile;
+        }
+    }
+
+    return std::nullopt;
+}
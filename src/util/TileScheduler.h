@@ -0,0 +1,70 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Order in which the tiles of the image are issued.
+enum class TileOrder {
+    // Row by row from the top-left corner.
+    Scanline,
+    // Outward from the center of the image.
+    Spiral,
+    // Along a Hilbert curve, so that consecutive tiles are adjacent.
+    Hilbert,
+};
+
+// Rectangular region [x_begin, x_end) x [y_begin, y_end) of the image.
+struct Tile {
+    unsigned int x_begin;
+    unsigned int y_begin;
+    unsigned int x_end;
+    unsigned int y_end;
+};
+
+/**
+ * Distributes the tiles of an image between threads.
+ *
+ * The tiles are dealt in order to one queue per thread. A thread takes tiles
+ * from the front of its own queue, and once it is empty, steals from the back
+ * of the queues of other threads, so that the threads finish at about the
+ * same time.
+ */
+class TileScheduler {
+   public:
+    /**
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param tile_size Width and height of a tile in pixels.
+     * @param order Order in which the tiles are issued.
+     * @param num_threads Number of threads fetching tiles.
+     */
+    TileScheduler(unsigned int width, unsigned int height,
+                  unsigned int tile_size, TileOrder order,
+                  unsigned int num_threads);
+
+    /**
+     * Fetch the next tile to be rendered by a thread.
+     *
+     * @param thread Index of the calling thread in [0, num_threads).
+     * @return The tile, or std::nullopt if all tiles have been fetched.
+     */
+    [[nodiscard]] std::optional<Tile> next(unsigned int thread);
+
+    // Total number of tiles.
+    [[nodiscard]] size_t size() const { return num_tiles; }
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    size_t num_tiles;
+    std::vector<std::unique_ptr<Queue>> queues;
+};
+
+#endif
@@ -13,9 +13,12 @@ void Timer::stop() {
         return;
     }
     is_stopped = true;
+    std::cout << "[Timer] " << name << ": " << elapsed() << " ms\n";
+}
+
+float Timer::elapsed() const {
     const auto end_time = std::chrono::high_resolution_clock::now();
     const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
         end_time - start_time);
-    std::cout << "[Timer] " << name << ": "
-              << static_cast<float>(duration.count()) * (1.F / 1e6F) << " ms\n";
+    return static_cast<float>(duration.count()) * (1.F / 1e6F);
 }
@@ -14,6 +14,11 @@ class Timer {
     ~Timer();
     void stop();
 
+    /**
+     * Get the time elapsed since the timer started, in milliseconds.
+     */
+    [[nodiscard]] float elapsed() const;
+
    private:
     std::string name;
     std::chrono::high_resolution_clock::time_point start_time;
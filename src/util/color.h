@@ -0,0 +1,13 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <Eigen/Core>
+
+/**
+ * Compute the relative luminance of a linear RGB color (Rec. 709).
+ */
+inline float luminance(const Eigen::Vector3f& color) {
+    return color.dot(Eigen::Vector3f(0.2126F, 0.7152F, 0.0722F));
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "hash.h"
+
+#include <bit>
+#include <cstring>
+
+#include "MappedFile.h"
+
+namespace {
+
+static const uint64_t C1 = 0x87c37b91114253d5ULL;
+static const uint64_t C2 = 0x4cf5ad432745937fULL;
+
+static uint64_t mix_word(uint64_t word) {
+    word *= C1;
+    word = std::rotl(word, 31);
+    word *= C2;
+    return word;
+}
+
+static uint64_t finalize(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+}  // namespace
+
+Hasher::Hasher(const uint64_t seed) : state(seed) {}
+
+void Hasher::update(const void* const data, const size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const size_t num_words = size / sizeof(uint64_t);
+
+    for (size_t i = 0; i < num_words; i++) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+        mix(word);
+    }
+
+    // The tail is mixed as a whole word, so that the values shorter than a
+    // word added by successive calls do not commute or cancel out.
+    const size_t tail = size % sizeof(uint64_t);
+    if (tail != 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + num_words * sizeof(uint64_t), tail);
+        mix(word);
+    }
+
+    length += size;
+}
+
+void Hasher::mix(const uint64_t word) {
+    state ^= mix_word(word);
+    state = std::rotl(state, 27) * 5 + 0x52dce729;
+}
+
+uint64_t Hasher::digest() const { return finalize(state ^ length); }
+
+std::optional<uint64_t> hash_file(const std::filesystem::path& path) {
+    const MappedFile file(path);
+    if (!file.is_open()) return std::nullopt;
+
+    Hasher hasher;
+    hasher.update(file.data(), file.size());
+    return hasher.digest();
+}
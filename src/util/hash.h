@@ -0,0 +1,62 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+/**
+ * Incremental 64-bit non-cryptographic hash, used to detect changes of files
+ * and data. The bytes are mixed 8 at a time as in MurmurHash3.
+ *
+ * Reference:
+ * https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+ */
+class Hasher {
+   public:
+    explicit Hasher(uint64_t seed = 0);
+
+    /**
+     * Add a range of bytes to the hash.
+     */
+    void update(const void* data, size_t size);
+
+    /**
+     * Add the bytes of a plain value to the hash.
+     */
+    template <typename T>
+    void update(const T& value) {
+        update(&value, sizeof(T));
+    }
+
+    /**
+     * Add the size and the bytes of the elements of a vector to the hash.
+     */
+    template <typename T>
+    void update(const std::vector<T>& values) {
+        update(values.size());
+        update(values.data(), values.size() * sizeof(T));
+    }
+
+    [[nodiscard]] uint64_t digest() const;
+
+   private:
+    /**
+     * Mix a word into the state.
+     */
+    void mix(uint64_t word);
+
+    uint64_t state;
+    uint64_t length = 0;
+};
+
+/**
+ * Hash the contents of a file.
+ *
+ * @return The hash, or std::nullopt if the file cannot be read.
+ */
+std::optional<uint64_t> hash_file(const std::filesystem::path& path);
+
+#endif
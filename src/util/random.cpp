@@ -1,4 +1,41 @@
 #include "random.h"
 
-std::random_device rd;
-std::minstd_rand rng = std::minstd_rand(rd());
+Random::Random(const uint64_t seed, const uint64_t stream)
+    : state(0), increment((stream << 1U) | 1U) {
+    next_uint();
+    state += seed;
+    next_uint();
+}
+
+uint32_t Random::next_uint() {
+    const uint64_t old_state = state;
+    state = old_state * 6364136223846793005ULL + increment;
+    const auto xorshifted =
+        static_cast<uint32_t>(((old_state >> 18U) ^ old_state) >> 27U);
+    const auto rot = static_cast<uint32_t>(old_state >> 59U);
+    return (xorshifted >> rot) | (xorshifted << ((~rot + 1U) & 31U));
+}
+
+float Random::uniform() {
+    // Use the upper 24 bits, so that the result is exactly representable and
+    // strictly less than 1.
+    return static_cast<float>(next_uint() >> 8U) * 0x1p-24F;
+}
+
+uint32_t Random::uniform_int(const uint32_t n) {
+    // Lemire's multiply-shift, without the rejection step: the bias is
+    // negligible for the small ranges used here.
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(next_uint()) * static_cast<uint64_t>(n)) >>
+        32U);
+}
+
+uint64_t Random::hash(uint64_t x) {
+    // SplitMix64 finalizer
+    x ^= x >> 30U;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27U;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31U;
+    return x;
+}
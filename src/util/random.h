@@ -1,9 +1,53 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
-#include <random>
+#include <cstdint>
 
-extern std::random_device rd;
-extern std::minstd_rand rng;
+/**
+ * Lightweight PCG32 random number generator.
+ *
+ * A generator is cheap to construct and is meant to be owned by a single
+ * thread, e.g. one per pixel sample, so that no state is shared between
+ * threads and the same seed always produces the same sequence.
+ *
+ * Reference:
+ * https://www.pcg-random.org/
+ */
+class Random {
+   public:
+    /**
+     * Construct a generator.
+     *
+     * @param seed Starting point of the sequence.
+     * @param stream Index of the sequence. Generators with different streams
+     * produce independent sequences.
+     */
+    Random(uint64_t seed, uint64_t stream);
+
+    /**
+     * Generate a uniformly distributed 32-bit integer.
+     */
+    uint32_t next_uint();
+
+    /**
+     * Generate a uniformly distributed float in [0, 1).
+     */
+    float uniform();
+
+    /**
+     * Generate a uniformly distributed integer in [0, n).
+     */
+    uint32_t uniform_int(uint32_t n);
+
+    /**
+     * Scramble the bits of a 64-bit integer, e.g. to derive independent seeds
+     * from consecutive indices.
+     */
+    static uint64_t hash(uint64_t x);
+
+   private:
+    uint64_t state;
+    uint64_t increment;
+};
 
 #endif
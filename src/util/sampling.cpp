@@ -0,0 +1,186 @@
+#include "sampling.h"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../SurfaceInteraction.h"
+
+namespace {
+
+static const float PI = std::numbers::pi_v<float>;
+
+// Below sin^2(1.5 degrees), 1 - cos(theta) is computed from sin^2(theta) to
+// avoid catastrophic cancellation.
+static const float SMALL_SIN2_THETA = 0.00068523F;
+
+static float safe_sqrt(const float x) { return std::sqrt(std::max(x, 0.F)); }
+
+/**
+ * Compute 1 - cos(theta_max) of the cone subtended by a sphere, given
+ * sin^2(theta_max).
+ */
+static float one_minus_cos_theta_max(const float sin2_theta_max) {
+    if (sin2_theta_max < SMALL_SIN2_THETA) return sin2_theta_max / 2;
+    return 1 - safe_sqrt(1 - sin2_theta_max);
+}
+
+/**
+ * Compute the angle between two unit vectors, accurately also for nearly
+ * parallel vectors.
+ */
+static float angle_between(const Eigen::Vector3f& a,
+                           const Eigen::Vector3f& b) {
+    if (a.dot(b) < 0) {
+        return PI - 2 * std::asin(std::min((a + b).norm() / 2, 1.F));
+    }
+    return 2 * std::asin(std::min((b - a).norm() / 2, 1.F));
+}
+
+/**
+ * Normalize the component of `v` perpendicular to the unit vector `w`.
+ */
+static Eigen::Vector3f orthonormalize(const Eigen::Vector3f& v,
+                                      const Eigen::Vector3f& w) {
+    return (v - v.dot(w) * w).normalized();
+}
+
+}  // namespace
+
+Eigen::Vector3f sample_uniform_sphere(Random& rng) {
+    // https://devforum.roblox.com/t/how-to-generate-a-random-rotation-and-much-more/1549051
+    const float a = 2 * PI * rng.uniform();
+    const float x = 2 * rng.uniform() - 1;
+    const float r = std::sqrt(1 - x * x);
+    return {x, r * std::cos(a), r * std::sin(a)};
+}
+
+Eigen::Vector3f sample_sphere_cone(const Eigen::Vector3f& center,
+                                   const float radius,
+                                   const Eigen::Vector3f& origin,
+                                   Random& rng) {
+    const Eigen::Vector3f to_center = center - origin;
+    const float distance2 = to_center.squaredNorm();
+    const float sin2_theta_max = radius * radius / distance2;
+    const float sin_theta_max = std::sqrt(sin2_theta_max);
+
+    // Sample the angle theta from the direction of the center, uniformly in
+    // solid angle
+    const float u = rng.uniform();
+    float sin2_theta;
+    float cos_theta;
+    if (sin2_theta_max < SMALL_SIN2_THETA) {
+        sin2_theta = sin2_theta_max * u;
+        cos_theta = std::sqrt(1 - sin2_theta);
+    } else {
+        const float cos_theta_max = safe_sqrt(1 - sin2_theta_max);
+        cos_theta = (cos_theta_max - 1) * u + 1;
+        sin2_theta = 1 - cos_theta * cos_theta;
+    }
+
+    // Angle at the center between the origin and the sampled point
+    const float cos_alpha =
+        sin2_theta / sin_theta_max +
+        cos_theta * safe_sqrt(1 - sin2_theta / sin2_theta_max);
+    const float sin_alpha = safe_sqrt(1 - cos_alpha * cos_alpha);
+    const float phi = 2 * PI * rng.uniform();
+
+    // Normal of the sphere at the sampled point, in a frame where the origin
+    // lies along +z from the center
+    const Eigen::Vector3f local_normal{sin_alpha * std::cos(phi),
+                                       sin_alpha * std::sin(phi), cos_alpha};
+    const Eigen::Matrix3f frame = SurfaceInteraction::make_tangent_space(
+        -to_center / std::sqrt(distance2), Eigen::Vector3f::Zero());
+
+    return center + radius * (frame * local_normal);
+}
+
+float sphere_solid_angle(const Eigen::Vector3f& center, const float radius,
+                         const Eigen::Vector3f& origin) {
+    const float sin2_theta_max =
+        radius * radius / (center - origin).squaredNorm();
+    return 2 * PI * one_minus_cos_theta_max(sin2_theta_max);
+}
+
+std::optional<Eigen::Vector3f> sample_spherical_triangle(
+    const std::array<Eigen::Vector3f, 3>& vertices,
+    const Eigen::Vector3f& origin, Random& rng) {
+    // Vertices of the spherical triangle on the unit sphere around the origin
+    const Eigen::Vector3f a = (vertices[0] - origin).normalized();
+    const Eigen::Vector3f b = (vertices[1] - origin).normalized();
+    const Eigen::Vector3f c = (vertices[2] - origin).normalized();
+
+    // Normals of the planes of the edges
+    Eigen::Vector3f n_ab = a.cross(b);
+    Eigen::Vector3f n_bc = b.cross(c);
+    Eigen::Vector3f n_ca = c.cross(a);
+    if (n_ab.squaredNorm() == 0 || n_bc.squaredNorm() == 0 ||
+        n_ca.squaredNorm() == 0) {
+        return std::nullopt;
+    }
+    n_ab.normalize();
+    n_bc.normalize();
+    n_ca.normalize();
+
+    // Angles at the vertices of the spherical triangle
+    const float alpha = angle_between(n_ab, -n_ca);
+    const float beta = angle_between(n_bc, -n_ab);
+    const float gamma = angle_between(n_ca, -n_bc);
+
+    // Sample the area of the sub-triangle (a, b, c'), where c' is on the arc
+    // between a and c
+    const float area_pi = alpha + beta + gamma;
+    const float sub_area_pi = PI + rng.uniform() * (area_pi - PI);
+
+    // Find c' from the area of the sub-triangle
+    const float cos_alpha = std::cos(alpha);
+    const float sin_alpha = std::sin(alpha);
+    const float sin_phi =
+        std::sin(sub_area_pi) * cos_alpha - std::cos(sub_area_pi) * sin_alpha;
+    const float cos_phi =
+        std::cos(sub_area_pi) * cos_alpha + std::sin(sub_area_pi) * sin_alpha;
+    const float k1 = cos_phi + cos_alpha;
+    const float k2 = sin_phi - sin_alpha * a.dot(b);
+    // Clamped, since the triangle may cover almost the whole hemisphere
+    const float cos_b = std::clamp(
+        (k2 + (k2 * cos_phi - k1 * sin_phi) * cos_alpha) /
+            ((k2 * sin_phi + k1 * cos_phi) * sin_alpha),
+        -1.F, 1.F);
+    const float sin_b = safe_sqrt(1 - cos_b * cos_b);
+    const Eigen::Vector3f c_prime = cos_b * a + sin_b * orthonormalize(c, a);
+
+    // Sample the direction on the arc between b and c'
+    const float cos_theta = 1 - rng.uniform() * (1 - c_prime.dot(b));
+    const float sin_theta = safe_sqrt(1 - cos_theta * cos_theta);
+    const Eigen::Vector3f w =
+        cos_theta * b + sin_theta * orthonormalize(c_prime, b);
+
+    // Intersect the direction with the triangle for its barycentric
+    // coordinates
+    const Eigen::Vector3f e1 = vertices[1] - vertices[0];
+    const Eigen::Vector3f e2 = vertices[2] - vertices[0];
+    const Eigen::Vector3f s1 = w.cross(e2);
+    const float divisor = s1.dot(e1);
+    if (divisor == 0) return Eigen::Vector3f::Constant(1.F / 3);
+
+    const Eigen::Vector3f s = origin - vertices[0];
+    float b1 = std::clamp(s.dot(s1) / divisor, 0.F, 1.F);
+    float b2 = std::clamp(w.dot(s.cross(e1)) / divisor, 0.F, 1.F);
+    if (b1 + b2 > 1) {
+        const float sum = b1 + b2;
+        b1 /= sum;
+        b2 /= sum;
+    }
+    return Eigen::Vector3f(1 - b1 - b2, b1, b2);
+}
+
+float triangle_solid_angle(const std::array<Eigen::Vector3f, 3>& vertices,
+                           const Eigen::Vector3f& origin) {
+    // Van Oosterom and Strackee's formula
+    const Eigen::Vector3f a = (vertices[0] - origin).normalized();
+    const Eigen::Vector3f b = (vertices[1] - origin).normalized();
+    const Eigen::Vector3f c = (vertices[2] - origin).normalized();
+    return std::abs(
+        2 * std::atan2(a.dot(b.cross(c)), 1 + a.dot(b) + a.dot(c) + b.dot(c)));
+}
@@ -0,0 +1,76 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <Eigen/Core>
+#include <array>
+#include <optional>
+
+#include "random.h"
+
+/**
+ * Sample a uniformly distributed unit vector.
+ *
+ * @param [in,out] rng Random number generator.
+ * @return Unit vector.
+ */
+[[nodiscard]] Eigen::Vector3f sample_uniform_sphere(Random& rng);
+
+/**
+ * Sample a point on the part of a sphere visible from a point outside of it,
+ * uniformly in the solid angle subtended by the sphere.
+ *
+ * Reference:
+ * https://pbr-book.org/4ed/Shapes/Spheres#SamplingSpheres
+ *
+ * @param [in] center Center of the sphere.
+ * @param [in] radius Radius of the sphere.
+ * @param [in] origin Point outside the sphere.
+ * @param [in,out] rng Random number generator.
+ * @return Point on the sphere.
+ */
+[[nodiscard]] Eigen::Vector3f sample_sphere_cone(const Eigen::Vector3f& center,
+                                                 float radius,
+                                                 const Eigen::Vector3f& origin,
+                                                 Random& rng);
+
+/**
+ * Compute the solid angle subtended by a sphere from a point outside of it.
+ *
+ * @param [in] center Center of the sphere.
+ * @param [in] radius Radius of the sphere.
+ * @param [in] origin Point outside the sphere.
+ * @return Solid angle in steradians.
+ */
+[[nodiscard]] float sphere_solid_angle(const Eigen::Vector3f& center,
+                                       float radius,
+                                       const Eigen::Vector3f& origin);
+
+/**
+ * Sample a point on a triangle uniformly in the solid angle it subtends from
+ * a point, with Arvo's method.
+ *
+ * Reference:
+ * https://pbr-book.org/4ed/Shapes/Triangles#SphericalTriangleSampling
+ *
+ * @param [in] vertices Vertices of the triangle.
+ * @param [in] origin Point the triangle is seen from.
+ * @param [in,out] rng Random number generator.
+ * @return Barycentric coordinates of the sampled point, or nullopt if the
+ * triangle is degenerate as seen from the point.
+ */
+[[nodiscard]] std::optional<Eigen::Vector3f> sample_spherical_triangle(
+    const std::array<Eigen::Vector3f, 3>& vertices,
+    const Eigen::Vector3f& origin, Random& rng);
+
+/**
+ * Compute the solid angle subtended by a triangle from a point.
+ *
+ * @param [in] vertices Vertices of the triangle.
+ * @param [in] origin Point the triangle is seen from.
+ * @return Solid angle in steradians.
+ */
+[[nodiscard]] float triangle_solid_angle(
+    const std::array<Eigen::Vector3f, 3>& vertices,
+    const Eigen::Vector3f& origin);
+
+#endif
@@ -0,0 +1,51 @@
+#include "simd.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+static SimdLevel detect_simd_level() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    // SSE2 is part of the x86-64 baseline.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    return SimdLevel::SSE;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    // The OS must save the AVX registers on context switches.
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (max_leaf < 7 || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return SimdLevel::SSE;
+    }
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    return avx2 ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+}  // namespace
+
+SimdLevel supported_simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+unsigned int simd_width(const SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE:
+            return 4;
+        case SimdLevel::AVX2:
+            return 8;
+        default:
+            return 1;
+    }
+}
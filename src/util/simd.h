@@ -0,0 +1,41 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Defined when the SSE2 and AVX2 kernels can be compiled.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_X86_64
+#endif
+
+// Enable AVX2 for a single function, so that the rest of the program still
+// runs on CPUs without it. MSVC accepts the intrinsics without the attribute.
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+/**
+ * Instruction sets used by the SIMD kernels, ordered from the least to the
+ * most capable.
+ */
+enum class SimdLevel {
+    // No SIMD kernel, primitives are intersected one at a time.
+    Scalar,
+    // 4-wide SSE2.
+    SSE,
+    // 8-wide AVX2.
+    AVX2,
+};
+
+/**
+ * Get the most capable instruction set supported by both the build and the
+ * CPU running it. The CPU is queried once, on the first call.
+ */
+SimdLevel supported_simd_level();
+
+/**
+ * Get the number of floats processed at once by an instruction set.
+ */
+unsigned int simd_width(SimdLevel level);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Check that the wide BVH traversals with the SIMD kernels find the same hits
+ * as the scalar traversal of the binary tree, for rays along the axes and
+ * rays whose direction has components of -0.
+ */
+
+#include <Eigen/Core>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../src/bvh/AABBTree.h"
+#include "../src/bvh/BVHOptions.h"
+#include "../src/geometry/TriangleMesh.h"
+#include "../src/util/random.h"
+#include "../src/util/simd.h"
+
+namespace {
+
+static const uint32_t NUM_TRIANGLES = 4096;
+static const uint32_t NUM_ORIGINS = 256;
+static const float TRIANGLE_SIZE = 0.1F;
+static const float TOLERANCE = 1e-4F;
+
+/**
+ * Build a tree over a mesh of small triangles scattered in [-1, 1]^3, with
+ * half of them lying in planes perpendicular to an axis.
+ */
+static std::unique_ptr<AABBTree> build_tree(const SimdLevel simd) {
+    Random rng(1, 0);
+    const auto random_point = [&]() -> Eigen::Vector3f {
+        return {2 * rng.uniform() - 1, 2 * rng.uniform() - 1,
+                2 * rng.uniform() - 1};
+    };
+
+    std::vector<Eigen::Vector3f> positions;
+    std::vector<std::array<uint32_t, 3>> indices;
+    for (uint32_t i = 0; i < NUM_TRIANGLES; i++) {
+        const Eigen::Vector3f v0 = random_point();
+        Eigen::Vector3f e1 = TRIANGLE_SIZE * random_point();
+        Eigen::Vector3f e2 = TRIANGLE_SIZE * random_point();
+        if (i % 2 == 0) {
+            const uint32_t axis = rng.uniform_int(3);
+            e1[axis] = 0;
+            e2[axis] = 0;
+        }
+        const auto first = static_cast<uint32_t>(positions.size());
+        positions.insert(positions.end(), {v0, v0 + e1, v0 + e2});
+        indices.push_back({first, first + 1, first + 2});
+    }
+
+    std::vector<std::unique_ptr<Geometry>> objects;
+    objects.emplace_back(std::make_unique<TriangleMesh>(
+        std::move(positions), std::vector<Eigen::Vector3f>{},
+        std::vector<Eigen::Vector2f>{}, std::move(indices), nullptr));
+
+    BVHOptions options;
+    options.simd = simd;
+    return std::make_unique<AABBTree>(std::move(objects), options);
+}
+
+/**
+ * Get the directions along the axes and the diagonals, once with +0 and once
+ * with -0 in place of the zero components.
+ */
+static std::vector<Eigen::Vector3f> test_directions() {
+    std::vector<Eigen::Vector3f> directions;
+    for (const float zero : {0.F, -0.F}) {
+        for (int x = -1; x <= 1; x++) {
+            for (int y = -1; y <= 1; y++) {
+                for (int z = -1; z <= 1; z++) {
+                    if (x == 0 && y == 0 && z == 0) continue;
+                    const Eigen::Vector3f direction(
+                        x == 0 ? zero : static_cast<float>(x),
+                        y == 0 ? zero : static_cast<float>(y),
+                        z == 0 ? zero : static_cast<float>(z));
+                    directions.emplace_back(direction.normalized());
+                }
+            }
+        }
+    }
+    return directions;
+}
+
+}  // namespace
+
+int main() {
+    const SimdLevel supported = supported_simd_level();
+    if (supported == SimdLevel::Scalar) {
+        std::cout << "No SIMD kernel to compare with.\n";
+        return EXIT_SUCCESS;
+    }
+
+    const std::unique_ptr<AABBTree> reference = build_tree(SimdLevel::Scalar);
+    const std::vector<Eigen::Vector3f> directions = test_directions();
+
+    unsigned int num_mismatches = 0;
+    for (const SimdLevel simd : {SimdLevel::SSE, SimdLevel::AVX2}) {
+        if (simd > supported) continue;
+        const std::unique_ptr<AABBTree> tree = build_tree(simd);
+
+        Random rng(2, 0);
+        for (uint32_t i = 0; i < NUM_ORIGINS; i++) {
+            const Eigen::Vector3f origin(2.4F * rng.uniform() - 1.2F,
+                                         2.4F * rng.uniform() - 1.2F,
+                                         2.4F * rng.uniform() - 1.2F);
+            for (const Eigen::Vector3f& direction : directions) {
+                const Ray ray(origin, direction);
+                const Intersection expected = reference->intersect(ray);
+                const Intersection actual = tree->intersect(ray);
+
+                const bool same_hit =
+                    expected.has_intersection() == actual.has_intersection() &&
+                    (!expected.has_intersection() ||
+                     std::abs(expected.t - actual.t) <= TOLERANCE);
+                const bool same_occlusion =
+                    reference->occluded(ray) == tree->occluded(ray);
+                if (!same_hit || !same_occlusion) {
+                    std::cerr << "Mismatch with SIMD width "
+                              << simd_width(simd) << " for ray from "
+                              << origin.transpose() << " toward "
+                              << direction.transpose() << "\n";
+                    num_mismatches++;
+                }
+            }
+        }
+    }
+
+    if (num_mismatches > 0) {
+        std::cerr << num_mismatches << " rays traversed differently.\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "All traversals agree.\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+/**
+ * Check that the hash of a sequence of values shorter than a word, such as
+ * the options in the key of the BVH cache, depends on their order and does
+ * not cancel out equal values.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "../src/util/hash.h"
+
+namespace {
+
+template <typename T>
+static uint64_t hash_pair(const T first, const T second) {
+    Hasher hasher;
+    hasher.update(first);
+    hasher.update(second);
+    return hasher.digest();
+}
+
+/**
+ * Check that two hashes differ, reporting them otherwise.
+ */
+static bool differ(const char* const name, const uint64_t a,
+                   const uint64_t b) {
+    if (a != b) return true;
+    std::cerr << "Same hash for " << name << ": " << a << "\n";
+    return false;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+    // Swapped values, as for `sah_bins` and `max_leaf_size`.
+    ok &= differ("swapped integers", hash_pair(16U, 8U), hash_pair(8U, 16U));
+    // Equal values, as for `traversal_cost` and `intersection_cost`.
+    ok &= differ("equal floats", hash_pair(1.F, 1.F), hash_pair(3.F, 3.F));
+    ok &= differ("equal floats and zeros", hash_pair(1.F, 1.F),
+                 hash_pair(0.F, 0.F));
+    ok &= differ("swapped bytes", hash_pair<uint8_t>(1, 2),
+                 hash_pair<uint8_t>(2, 1));
+    // Words still depend on their order.
+    ok &= differ("swapped words", hash_pair<uint64_t>(1, 2),
+                 hash_pair<uint64_t>(2, 1));
+
+    if (!ok) return EXIT_FAILURE;
+    std::cout << "All hashes differ.\n";
+    return EXIT_SUCCESS;
+}